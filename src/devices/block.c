@@ -131,6 +131,32 @@ void block_write(struct block *block, block_sector_t sector, const void *buffer)
     block->write_cnt++;
 }
 
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.  If
+   the driver supports it, this is a single device command rather
+   than CNT of them.  Returns after the block device has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void block_write_multiple(struct block *block, block_sector_t sector,
+                          size_t cnt, const void *buffer_)
+{
+    const uint8_t *buffer = buffer_;
+
+    if (cnt == 0)
+        return;
+    check_sector(block, sector);
+    check_sector(block, sector + cnt - 1);
+    ASSERT(block->type != BLOCK_FOREIGN);
+    if (block->ops->write_multiple != NULL)
+        block->ops->write_multiple(block->aux, sector, cnt, buffer);
+    else
+        for (size_t i = 0; i < cnt; i++)
+            block->ops->write(block->aux, sector + i,
+                              buffer + i * BLOCK_SECTOR_SIZE);
+    block->write_cnt += cnt;
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t block_size(struct block *block)
 {
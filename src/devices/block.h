@@ -59,6 +59,8 @@ struct block *block_next(struct block *);
 block_sector_t block_size(struct block *);
 void block_read(struct block *, block_sector_t, void *);
 void block_write(struct block *, block_sector_t, const void *);
+void block_write_multiple(struct block *, block_sector_t, size_t cnt,
+                          const void *);
 const char *block_name(struct block *);
 enum block_type block_type(struct block *);
 
@@ -71,6 +73,11 @@ struct block_operations
 {
    void (*read)(void *aux, block_sector_t, void *buffer);
    void (*write)(void *aux, block_sector_t, const void *buffer);
+
+   /* Writes CNT consecutive sectors at once.  Optional: null if
+      the driver can only write one sector at a time. */
+   void (*write_multiple)(void *aux, block_sector_t, size_t cnt,
+                          const void *buffer);
 };
 
 struct block *block_register(const char *name, enum block_type,
@@ -50,6 +50,10 @@
 #define CMD_READ_SECTOR_RETRY 0x20  /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30 /* WRITE SECTOR with retries. */
 
+/* Most sectors one READ or WRITE SECTOR command can transfer.
+   The Sector Count register holds 8 bits, and 0 would mean 256. */
+#define IDE_MAX_SECTORS 255
+
 /* An ATA device. */
 struct ata_disk
 {
@@ -80,12 +84,14 @@ struct channel
 static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
+static void ide_write_multiple(void *, block_sector_t, size_t cnt,
+                               const void *);
 
 static void reset_channel(struct channel *);
 static bool check_device_type(struct ata_disk *);
 static void identify_ata_device(struct ata_disk *);
 
-static void select_sector(struct ata_disk *, block_sector_t);
+static void select_sector(struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command(struct channel *, uint8_t command);
 static void input_sector(struct channel *, void *);
 static void output_sector(struct channel *, const void *);
@@ -338,7 +344,7 @@ static void ide_read(void *d_, block_sector_t sec_no, void *buffer)
     struct ata_disk *d = d_;
     struct channel *c = d->channel;
     lock_acquire(&c->lock);
-    select_sector(d, sec_no);
+    select_sector(d, sec_no, 1);
     issue_pio_command(c, CMD_READ_SECTOR_RETRY);
     sema_down(&c->completion_wait);
     if (!wait_while_busy(d))
@@ -353,35 +359,68 @@ static void ide_read(void *d_, block_sector_t sec_no, void *buffer)
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void ide_write(void *d_, block_sector_t sec_no, const void *buffer)
+{
+    ide_write_multiple(d_, sec_no, 1, buffer);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes, with WRITE
+   SECTOR commands of up to IDE_MAX_SECTORS sectors each.  The
+   disk asks for each sector in turn and interrupts once it has
+   taken it.  Returns after the disk has acknowledged receiving
+   all of the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void ide_write_multiple(void *d_, block_sector_t sec_no, size_t cnt,
+                               const void *buffer_)
 {
     struct ata_disk *d = d_;
     struct channel *c = d->channel;
+    const uint8_t *buffer = buffer_;
+
     lock_acquire(&c->lock);
-    select_sector(d, sec_no);
-    issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
-    if (!wait_while_busy(d))
-        PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
-    output_sector(c, buffer);
-    sema_down(&c->completion_wait);
+    while (cnt > 0)
+    {
+        size_t chunk = cnt < IDE_MAX_SECTORS ? cnt : IDE_MAX_SECTORS;
+
+        select_sector(d, sec_no, chunk);
+        issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
+        for (size_t i = 0; i < chunk; i++)
+        {
+            if (!wait_while_busy(d))
+                PANIC("%s: disk write failed, sector=%" PRDSNu,
+                      d->name, sec_no + i);
+            output_sector(c, buffer);
+            sema_down(&c->completion_wait);
+            buffer += BLOCK_SECTOR_SIZE;
+        }
+
+        sec_no += chunk;
+        cnt -= chunk;
+    }
     lock_release(&c->lock);
 }
 
 static struct block_operations ide_operations =
     {
         ide_read,
-        ide_write};
+        ide_write,
+        ide_write_multiple};
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void select_sector(struct ata_disk *d, block_sector_t sec_no)
+   writes SEC_NO and CNT to the disk's sector selection registers,
+   to transfer CNT sectors starting at SEC_NO.  (We use LBA
+   mode.) */
+static void select_sector(struct ata_disk *d, block_sector_t sec_no,
+                          size_t cnt)
 {
     struct channel *c = d->channel;
 
     ASSERT(sec_no < (1UL << 28));
+    ASSERT(cnt > 0 && cnt <= IDE_MAX_SECTORS);
 
     select_device_wait(d);
-    outb(reg_nsect(c), 1);
+    outb(reg_nsect(c), cnt);
     outb(reg_lbal(c), sec_no);
     outb(reg_lbam(c), sec_no >> 8);
     outb(reg_lbah(c), (sec_no >> 16));
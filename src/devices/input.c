@@ -1,15 +1,24 @@
 #include "devices/input.h"
 #include <debug.h>
+#include <list.h>
 #include "devices/intq.h"
 #include "devices/serial.h"
+#include "threads/thread.h"
 
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
 
+/* Threads blocked in input_getc_cancellable().
+   Protected by disabling interrupts. */
+static struct list readers;
+
+static void wake_readers(void);
+
 /* Initializes the input buffer. */
 void input_init(void)
 {
     intq_init(&buffer);
+    list_init(&readers);
 }
 
 /* Adds a key to the input buffer.
@@ -21,6 +30,7 @@ void input_putc(uint8_t key)
 
     intq_putc(&buffer, key);
     serial_notify();
+    wake_readers();
 }
 
 /* Retrieves a key from the input buffer.
@@ -38,6 +48,43 @@ uint8_t input_getc(void)
     return key;
 }
 
+/* Retrieves a key from the input buffer into *KEY.  If the
+   buffer is empty, waits for a key to be pressed, but gives up
+   and returns false if CANCELLED returns true.  CANCELLED is
+   checked again whenever input_wakeup_all() is called. */
+bool input_getc_cancellable(uint8_t *key, bool (*cancelled)(void))
+{
+    enum intr_level old_level;
+    bool got_key;
+
+    old_level = intr_disable();
+    while (intq_empty(&buffer) && !cancelled())
+    {
+        list_push_back(&readers, &thread_current()->elem);
+        thread_block();
+    }
+    got_key = !intq_empty(&buffer);
+    if (got_key)
+    {
+        *key = intq_getc(&buffer);
+        serial_notify();
+    }
+    intr_set_level(old_level);
+
+    return got_key;
+}
+
+/* Wakes every thread waiting in input_getc_cancellable() so
+   that it checks its cancellation condition again. */
+void input_wakeup_all(void)
+{
+    enum intr_level old_level;
+
+    old_level = intr_disable();
+    wake_readers();
+    intr_set_level(old_level);
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
@@ -46,3 +93,12 @@ bool input_full(void)
     ASSERT(intr_get_level() == INTR_OFF);
     return intq_full(&buffer);
 }
+
+/* Unblocks every thread in READERS.
+   Interrupts must be off. */
+static void wake_readers(void)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+    while (!list_empty(&readers))
+        thread_unblock(list_entry(list_pop_front(&readers), struct thread, elem));
+}
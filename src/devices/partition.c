@@ -313,7 +313,18 @@ static void partition_write(void *p_, block_sector_t sector, const void *buffer)
     block_write(p->block, p->start + sector, buffer);
 }
 
+/* Writes CNT sectors starting at SECTOR to partition P from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block has acknowledged receiving the data. */
+static void partition_write_multiple(void *p_, block_sector_t sector,
+                                     size_t cnt, const void *buffer)
+{
+    struct partition *p = p_;
+    block_write_multiple(p->block, p->start + sector, cnt, buffer);
+}
+
 static struct block_operations partition_operations =
     {
         partition_read,
-        partition_write};
+        partition_write,
+        partition_write_multiple};
@@ -128,6 +128,40 @@ void serial_putc(uint8_t byte)
     intr_set_level(old_level);
 }
 
+/* Sends the N bytes in BUFFER to the serial port.  Like calling
+   serial_putc() for each byte, but with interrupts disabled once
+   for the whole buffer and the interrupt enable register written
+   only when the transmit queue fills or the buffer is done. */
+void serial_putbuf(const uint8_t *buffer, size_t n)
+{
+    enum intr_level old_level = intr_disable();
+
+    if (mode != QUEUE)
+    {
+        if (mode == UNINIT)
+            init_poll();
+        while (n-- > 0)
+            putc_poll(*buffer++);
+    }
+    else
+    {
+        while (n-- > 0)
+        {
+            /* See serial_putc(). */
+            if (old_level == INTR_OFF && intq_full(&txq))
+                putc_poll(intq_getc(&txq));
+
+            /* If the queue is full, this waits for the transmit
+               interrupt, which the write_ier() below enabled. */
+            intq_putc(&txq, *buffer++);
+            if (n == 0 || intq_full(&txq))
+                write_ier();
+        }
+    }
+
+    intr_set_level(old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void serial_flush(void)
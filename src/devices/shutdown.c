@@ -8,6 +8,8 @@
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
@@ -86,6 +88,9 @@ void shutdown_power_off(void)
     const char s[] = "Shutdown";
     const char *p;
 
+#ifdef USERPROG
+    process_done();
+#endif
 #ifdef FILESYS
     filesys_done();
 #endif
@@ -137,5 +142,6 @@ static void print_stats(void)
     kbd_print_stats();
 #ifdef USERPROG
     exception_print_stats();
+    syscall_print_stats();
 #endif
 }
@@ -19,14 +19,7 @@ int main(int argc, char *argv[])
             success = false;
             continue;
         }
-        for (;;)
-        {
-            char buffer[1024];
-            int bytes_read = read(fd, buffer, sizeof buffer);
-            if (bytes_read == 0)
-                break;
-            write(STDOUT_FILENO, buffer, bytes_read);
-        }
+        copy_file_range(fd, STDOUT_FILENO, filesize(fd));
         close(fd);
     }
     return success ? EXIT_SUCCESS : EXIT_FAILURE;
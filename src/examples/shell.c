@@ -5,6 +5,11 @@
 
 static void read_line(char line[], size_t);
 static bool backspace(char **pos, char line[]);
+static void run_pipeline(char *line);
+static int parse_redirects(char *command, struct spawn_action[]);
+
+/* Maximum number of commands in a pipeline. */
+#define MAX_STAGES 8
 
 int main(void)
 {
@@ -30,13 +35,7 @@ int main(void)
             /* Empty command. */
         }
         else
-        {
-            pid_t pid = exec(command);
-            if (pid != PID_ERROR)
-                printf("\"%s\": exit code %d\n", command, wait(pid));
-            else
-                printf("exec failed\n");
-        }
+            run_pipeline(command);
     }
 
     printf("Shell exiting.");
@@ -99,3 +98,132 @@ static bool backspace(char **pos, char line[])
     else
         return false;
 }
+
+/* Runs the commands in LINE, separated by "|", each with its
+   standard output connected to the next one's standard input
+   through a pipe, and waits for all of them. */
+static void run_pipeline(char *line)
+{
+    char *stages[MAX_STAGES];
+    pid_t pids[MAX_STAGES];
+    int stage_cnt = 0;
+    int in_fd = -1;
+    char *stage, *save_ptr;
+
+    for (stage = strtok_r(line, "|", &save_ptr); stage != NULL;
+         stage = strtok_r(NULL, "|", &save_ptr))
+    {
+        if (stage_cnt == MAX_STAGES)
+        {
+            printf("too many commands in pipeline\n");
+            return;
+        }
+        while (*stage == ' ')
+            stage++;
+        for (char *end = stage + strlen(stage); end > stage && end[-1] == ' ';)
+            *--end = '\0';
+        stages[stage_cnt++] = stage;
+    }
+
+    /* Start every command before waiting for any, so that a pipe
+       never fills up with no one to read it. */
+    for (int i = 0; i < stage_cnt; i++)
+    {
+        struct spawn_action actions[7];
+        int action_cnt = 0;
+        int fds[2] = {-1, -1};
+
+        if (in_fd != -1)
+        {
+            actions[action_cnt++] = (struct spawn_action){SPAWN_DUP, STDIN_FILENO, in_fd, NULL};
+            actions[action_cnt++] = (struct spawn_action){SPAWN_CLOSE, in_fd, 0, NULL};
+        }
+        if (i + 1 < stage_cnt)
+        {
+            if (pipe(fds) == -1)
+                printf("pipe failed\n");
+            else
+            {
+                actions[action_cnt++] = (struct spawn_action){SPAWN_DUP, STDOUT_FILENO, fds[1], NULL};
+                actions[action_cnt++] = (struct spawn_action){SPAWN_CLOSE, fds[0], 0, NULL};
+                actions[action_cnt++] = (struct spawn_action){SPAWN_CLOSE, fds[1], 0, NULL};
+            }
+        }
+
+        int redirect_cnt = parse_redirects(stages[i], actions + action_cnt);
+        pids[i] = PID_ERROR;
+        if (redirect_cnt >= 0)
+            pids[i] = spawn(stages[i], actions, action_cnt + redirect_cnt);
+        if (pids[i] == PID_ERROR)
+            printf("exec failed\n");
+
+        /* Only the children keep the write end open, so the next
+           command sees end of file once this one exits. */
+        if (in_fd != -1)
+            close(in_fd);
+        if (fds[1] != -1)
+            close(fds[1]);
+        in_fd = fds[0];
+    }
+    if (in_fd != -1)
+        close(in_fd);
+
+    for (int i = 0; i < stage_cnt; i++)
+        if (pids[i] != PID_ERROR)
+            printf("\"%s\": exit code %d\n", stages[i], wait(pids[i]));
+}
+
+/* Removes the "< FILE" and "> FILE" redirections that end
+   COMMAND, each followed by a space or the end of the line, and
+   stores the corresponding file actions in ACTIONS, which has
+   room for two.  An output file is created, or emptied if it
+   already exists.  Returns the number of actions, or -1 if the
+   redirections are malformed. */
+static int parse_redirects(char *command, struct spawn_action actions[])
+{
+    char *pos = strpbrk(command, "<>");
+    int action_cnt = 0;
+
+    if (pos == NULL)
+        return 0;
+
+    /* Trim the redirections and any spaces before them off the
+       command itself. */
+    char *end = pos;
+    while (end > command && end[-1] == ' ')
+        end--;
+
+    while (*pos != '\0')
+    {
+        struct spawn_action *a = &actions[action_cnt];
+        char op = *pos++;
+
+        if ((op != '<' && op != '>') || action_cnt == 2)
+            return -1;
+        while (*pos == ' ')
+            pos++;
+        a->type = SPAWN_OPEN;
+        a->fd = op == '<' ? STDIN_FILENO : STDOUT_FILENO;
+        a->src_fd = 0;
+        a->path = pos;
+        while (*pos != '\0' && *pos != ' ')
+            pos++;
+        if (pos == a->path)
+            return -1;
+
+        /* Terminate the file name and skip to the next
+           redirection. */
+        while (*pos == ' ')
+            *pos++ = '\0';
+        action_cnt++;
+    }
+    *end = '\0';
+
+    for (int i = 0; i < action_cnt; i++)
+        if (actions[i].fd == STDOUT_FILENO)
+        {
+            remove(actions[i].path);
+            create(actions[i].path, 0);
+        }
+    return action_cnt;
+}
@@ -0,0 +1,301 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Number of sectors in the cache. */
+#define CACHE_SIZE 64
+
+/* Milliseconds between flushes by the flusher thread. */
+#define CACHE_FLUSH_MS 1000
+
+/* Most sectors written back by one multi-sector write. */
+#define CACHE_RUN_MAX (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A cached sector of fs_device.
+
+   SECTOR is protected by cache_lock, and changes only while LOCK
+   is also held, so that a thread holding LOCK sees a stable
+   SECTOR.  The remaining members are protected by LOCK. */
+struct cache_entry
+{
+    block_sector_t sector; /* Sector held, or CACHE_UNUSED. */
+    struct lock lock;      /* Held while DATA is in use. */
+    bool dirty;            /* DATA newer than the disk? */
+    bool accessed;         /* Used since the clock hand last passed? */
+    uint8_t *data;         /* BLOCK_SECTOR_SIZE bytes of sector data. */
+};
+
+/* SECTOR of an entry that holds no sector. */
+#define CACHE_UNUSED ((block_sector_t)-1)
+
+static struct cache_entry cache[CACHE_SIZE];
+
+/* Protects every entry's SECTOR, and HAND. */
+static struct lock cache_lock;
+static size_t hand; /* Clock hand, the next entry to consider. */
+
+/* Serializes flushes, and protects run_buf. */
+static struct lock flush_lock;
+static uint8_t *run_buf; /* A run of sectors being written back. */
+
+static thread_func flusher NO_RETURN;
+static size_t flush_run(struct cache_entry **, size_t cnt);
+static struct cache_entry *get_entry(block_sector_t, bool need_data);
+static struct cache_entry *find_entry(block_sector_t);
+static struct cache_entry *evict_entry(void);
+
+/* Initializes the buffer cache and starts its flusher thread. */
+void cache_init(void)
+{
+    uint8_t *data;
+
+    data = palloc_get_multiple(PAL_ASSERT,
+                               CACHE_SIZE * BLOCK_SECTOR_SIZE / PGSIZE);
+    lock_init(&cache_lock);
+    for (size_t i = 0; i < CACHE_SIZE; i++)
+    {
+        struct cache_entry *e = &cache[i];
+        e->sector = CACHE_UNUSED;
+        lock_init(&e->lock);
+        e->dirty = false;
+        e->accessed = false;
+        e->data = data + i * BLOCK_SECTOR_SIZE;
+    }
+
+    lock_init(&flush_lock);
+    run_buf = palloc_get_page(PAL_ASSERT);
+    thread_create("flusher", PRI_DEFAULT, flusher, NULL);
+}
+
+/* Reads SIZE bytes starting at byte OFS of SECTOR on fs_device
+   into BUFFER, through the cache. */
+void cache_read(block_sector_t sector, void *buffer, size_t ofs, size_t size)
+{
+    struct cache_entry *e;
+
+    ASSERT(ofs + size <= BLOCK_SECTOR_SIZE);
+
+    e = get_entry(sector, true);
+    memcpy(buffer, e->data + ofs, size);
+    lock_release(&e->lock);
+}
+
+/* Writes SIZE bytes from BUFFER to SECTOR on fs_device, starting
+   at byte OFS of the sector.  The write reaches the cache at once
+   and the disk only when the sector is evicted or flushed, at the
+   latest by the flusher thread.  Writing a whole sector does not
+   read it first. */
+void cache_write(block_sector_t sector, const void *buffer, size_t ofs,
+                 size_t size)
+{
+    struct cache_entry *e;
+
+    ASSERT(ofs + size <= BLOCK_SECTOR_SIZE);
+
+    e = get_entry(sector, size < BLOCK_SECTOR_SIZE);
+    memcpy(e->data + ofs, buffer, size);
+    e->dirty = true;
+    lock_release(&e->lock);
+}
+
+/* Writes every dirty sector in the cache to disk.  Dirty sectors
+   with consecutive numbers go out together, CACHE_RUN_MAX at most
+   to a write. */
+void cache_flush(void)
+{
+    struct cache_entry *dirty[CACHE_SIZE];
+    size_t dirty_cnt = 0;
+
+    lock_acquire(&flush_lock);
+
+    /* Collect the dirty entries, sorted by sector.  An entry's
+       DIRTY is only a hint here, checked again by flush_run()
+       under the entry's lock. */
+    lock_acquire(&cache_lock);
+    for (size_t i = 0; i < CACHE_SIZE; i++)
+    {
+        struct cache_entry *e = &cache[i];
+        size_t j;
+
+        if (!e->dirty || e->sector == CACHE_UNUSED)
+            continue;
+        for (j = dirty_cnt++; j > 0 && dirty[j - 1]->sector > e->sector; j--)
+            dirty[j] = dirty[j - 1];
+        dirty[j] = e;
+    }
+    lock_release(&cache_lock);
+
+    for (size_t i = 0; i < dirty_cnt;)
+        i += flush_run(dirty + i, dirty_cnt - i);
+
+    lock_release(&flush_lock);
+}
+
+/* Flusher thread.  Writes dirty sectors back every
+   CACHE_FLUSH_MS milliseconds, so that data written long ago
+   does not wait for eviction or shutdown to reach the disk. */
+static void flusher(void *aux UNUSED)
+{
+    for (;;)
+    {
+        timer_msleep(CACHE_FLUSH_MS);
+        cache_flush();
+    }
+}
+
+/* Writes back a run of dirty sectors with consecutive numbers,
+   taken from the start of ENTRIES, which holds CNT entries sorted
+   by sector, in a single multi-sector write.  Returns the number
+   of ENTRIES consumed, at least 1.  flush_lock must be held.
+
+   The entries of the run stay locked until the write completes,
+   so that an eviction cannot write newer data to the same sectors
+   first. */
+static size_t flush_run(struct cache_entry **entries, size_t cnt)
+{
+    struct cache_entry *run[CACHE_RUN_MAX];
+    block_sector_t start = 0;
+    size_t run_cnt = 0;
+    size_t used = 0;
+
+    ASSERT(lock_held_by_current_thread(&flush_lock));
+
+    while (used < cnt && run_cnt < CACHE_RUN_MAX)
+    {
+        struct cache_entry *e = entries[used];
+
+        lock_acquire(&e->lock);
+        if (!e->dirty)
+        {
+            /* Written back since it was collected. */
+            lock_release(&e->lock);
+            used++;
+            continue;
+        }
+        if (run_cnt > 0 && e->sector != start + run_cnt)
+        {
+            /* Not next in the run, or evicted and reused since
+               it was collected.  Leave it for the next run. */
+            lock_release(&e->lock);
+            break;
+        }
+
+        if (run_cnt == 0)
+            start = e->sector;
+        memcpy(run_buf + run_cnt * BLOCK_SECTOR_SIZE, e->data,
+               BLOCK_SECTOR_SIZE);
+        run[run_cnt++] = e;
+        used++;
+    }
+
+    block_write_multiple(fs_device, start, run_cnt, run_buf);
+    for (size_t i = 0; i < run_cnt; i++)
+    {
+        run[i]->dirty = false;
+        lock_release(&run[i]->lock);
+    }
+
+    return used;
+}
+
+/* Returns the entry for SECTOR, locked, bringing SECTOR into the
+   cache if it is not there.  The entry's data is read from disk
+   only if NEED_DATA is true; otherwise the caller must overwrite
+   all of it. */
+static struct cache_entry *get_entry(block_sector_t sector, bool need_data)
+{
+    for (;;)
+    {
+        struct cache_entry *e;
+
+        lock_acquire(&cache_lock);
+        e = find_entry(sector);
+        if (e != NULL)
+        {
+            /* Wait for the entry without holding cache_lock, then
+               check that it was not evicted meanwhile. */
+            lock_release(&cache_lock);
+            lock_acquire(&e->lock);
+            if (e->sector == sector)
+            {
+                e->accessed = true;
+                return e;
+            }
+            lock_release(&e->lock);
+            continue;
+        }
+
+        e = evict_entry();
+        if (e == NULL)
+        {
+            /* Every entry is in use. */
+            lock_release(&cache_lock);
+            thread_yield();
+            continue;
+        }
+
+        if (e->dirty)
+        {
+            /* Write back the old sector before giving up the entry.
+               Lookups of the old sector still find the entry and
+               wait for the write, so they cannot read stale data
+               from disk.  The entry is now clean, and a later pass
+               can take it. */
+            lock_release(&cache_lock);
+            block_write(fs_device, e->sector, e->data);
+            e->dirty = false;
+            lock_release(&e->lock);
+            continue;
+        }
+
+        /* Lookups of SECTOR find the entry from here on, and wait
+           for its data to be read. */
+        e->sector = sector;
+        lock_release(&cache_lock);
+        if (need_data)
+            block_read(fs_device, sector, e->data);
+        e->accessed = true;
+        return e;
+    }
+}
+
+/* Returns the entry that holds SECTOR, or a null pointer.
+   cache_lock must be held. */
+static struct cache_entry *find_entry(block_sector_t sector)
+{
+    ASSERT(lock_held_by_current_thread(&cache_lock));
+
+    for (size_t i = 0; i < CACHE_SIZE; i++)
+        if (cache[i].sector == sector)
+            return &cache[i];
+    return NULL;
+}
+
+/* Chooses an entry to reuse by the clock algorithm, skipping
+   entries in use, and returns it locked.  Returns a null pointer
+   if every entry is in use.  cache_lock must be held. */
+static struct cache_entry *evict_entry(void)
+{
+    ASSERT(lock_held_by_current_thread(&cache_lock));
+
+    /* Two passes: the first may only clear accessed bits. */
+    for (size_t i = 0; i < 2 * CACHE_SIZE; i++)
+    {
+        struct cache_entry *e = &cache[hand];
+        hand = (hand + 1) % CACHE_SIZE;
+
+        if (!lock_try_acquire(&e->lock))
+            continue;
+        if (e->sector == CACHE_UNUSED || !e->accessed)
+            return e;
+        e->accessed = false;
+        lock_release(&e->lock);
+    }
+    return NULL;
+}
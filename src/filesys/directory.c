@@ -116,10 +116,12 @@ bool dir_lookup(const struct dir *dir, const char *name,
     ASSERT(dir != NULL);
     ASSERT(name != NULL);
 
+    inode_lock_dir(dir->inode);
     if (lookup(dir, name, &e, NULL))
         *inode = inode_open(e.inode_sector);
     else
         *inode = NULL;
+    inode_unlock_dir(dir->inode);
 
     return *inode != NULL;
 }
@@ -143,6 +145,8 @@ bool dir_add(struct dir *dir, const char *name, block_sector_t inode_sector)
     if (*name == '\0' || strlen(name) > NAME_MAX)
         return false;
 
+    inode_lock_dir(dir->inode);
+
     /* Check that NAME is not in use. */
     if (lookup(dir, name, NULL, NULL))
         goto done;
@@ -166,6 +170,7 @@ bool dir_add(struct dir *dir, const char *name, block_sector_t inode_sector)
     success = inode_write_at(dir->inode, &e, sizeof e, ofs) == sizeof e;
 
 done:
+    inode_unlock_dir(dir->inode);
     return success;
 }
 
@@ -182,6 +187,8 @@ bool dir_remove(struct dir *dir, const char *name)
     ASSERT(dir != NULL);
     ASSERT(name != NULL);
 
+    inode_lock_dir(dir->inode);
+
     /* Find directory entry. */
     if (!lookup(dir, name, &e, &ofs))
         goto done;
@@ -201,6 +208,7 @@ bool dir_remove(struct dir *dir, const char *name)
     success = true;
 
 done:
+    inode_unlock_dir(dir->inode);
     inode_close(inode);
     return success;
 }
@@ -211,15 +219,19 @@ done:
 bool dir_readdir(struct dir *dir, char name[NAME_MAX + 1])
 {
     struct dir_entry e;
+    bool found = false;
 
+    inode_lock_dir(dir->inode);
     while (inode_read_at(dir->inode, &e, sizeof e, dir->pos) == sizeof e)
     {
         dir->pos += sizeof e;
         if (e.in_use)
         {
             strlcpy(name, e.name, NAME_MAX + 1);
-            return true;
+            found = true;
+            break;
         }
     }
-    return false;
+    inode_unlock_dir(dir->inode);
+    return found;
 }
@@ -1,14 +1,23 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 
-/* An open file. */
+/* An open file.  Several file descriptors, possibly in different
+   processes, may share one struct file and its position.
+
+   An open file is either backed by INODE or is one end of PIPE,
+   in which case INODE is null and it has no position. */
 struct file
 {
-    struct inode *inode; /* File's inode. */
+    struct inode *inode; /* File's inode, or null for a pipe. */
     off_t pos;           /* Current position. */
     bool deny_write;     /* Has file_deny_write() been called? */
+    int ref_cnt;         /* References, see file_dup(). */
+    struct pipe *pipe;   /* Pipe, or null for an inode. */
+    bool write_end;      /* For a pipe, is this its write end? */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -22,6 +31,7 @@ struct file *file_open(struct inode *inode)
         file->inode = inode;
         file->pos = 0;
         file->deny_write = false;
+        file->ref_cnt = 1;
         return file;
     }
     else
@@ -32,25 +42,71 @@ struct file *file_open(struct inode *inode)
     }
 }
 
+/* Opens one end of PIPE, the write end if WRITE_END is true or
+   the read end otherwise, and returns the new file.  Closing the
+   file closes that end of PIPE.  Returns a null pointer if an
+   allocation fails. */
+struct file *file_open_pipe(struct pipe *pipe, bool write_end)
+{
+    struct file *file = calloc(1, sizeof *file);
+    if (file != NULL)
+    {
+        file->pipe = pipe;
+        file->write_end = write_end;
+        file->ref_cnt = 1;
+    }
+    return file;
+}
+
 /* Opens and returns a new file for the same inode as FILE.
-   Returns a null pointer if unsuccessful. */
+   Returns a null pointer if unsuccessful, or if FILE is a pipe. */
 struct file *file_reopen(struct file *file)
 {
+    if (file->pipe != NULL)
+        return NULL;
     return file_open(inode_reopen(file->inode));
 }
 
-/* Closes FILE. */
+/* Returns true if FILE is one end of a pipe. */
+bool file_is_pipe(struct file *file)
+{
+    return file->pipe != NULL;
+}
+
+/* Returns a new reference to FILE, which shares FILE's position.
+   Each reference must be closed with file_close(). */
+struct file *file_dup(struct file *file)
+{
+    enum intr_level old_level = intr_disable();
+    file->ref_cnt++;
+    intr_set_level(old_level);
+
+    return file;
+}
+
+/* Closes FILE.  The file is released when its last reference is
+   closed. */
 void file_close(struct file *file)
 {
     if (file != NULL)
     {
+        enum intr_level old_level = intr_disable();
+        bool last = --file->ref_cnt == 0;
+        intr_set_level(old_level);
+
+        if (!last)
+            return;
+
+        if (file->pipe != NULL)
+            pipe_close(file->pipe, file->write_end);
         file_allow_write(file);
         inode_close(file->inode);
         free(file);
     }
 }
 
-/* Returns the inode encapsulated by FILE. */
+/* Returns the inode encapsulated by FILE, or a null pointer if
+   FILE is a pipe. */
 struct inode *file_get_inode(struct file *file)
 {
     return file->inode;
@@ -60,9 +116,15 @@ struct inode *file_get_inode(struct file *file)
    starting at the file's current position.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   If FILE is the read end of a pipe, waits for data and returns
+   0 only once every write end is closed; if it is the write end,
+   returns -1. */
 off_t file_read(struct file *file, void *buffer, off_t size)
 {
+    if (file->pipe != NULL)
+        return file->write_end ? -1 : pipe_read(file->pipe, buffer, size);
+
     off_t bytes_read = inode_read_at(file->inode, buffer, size, file->pos);
     file->pos += bytes_read;
     return bytes_read;
@@ -72,9 +134,12 @@ off_t file_read(struct file *file, void *buffer, off_t size)
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   The file's current position is unaffected. */
+   The file's current position is unaffected.
+   Returns -1 if FILE is a pipe. */
 off_t file_read_at(struct file *file, void *buffer, off_t size, off_t file_ofs)
 {
+    if (file->pipe != NULL)
+        return -1;
     return inode_read_at(file->inode, buffer, size, file_ofs);
 }
 
@@ -84,9 +149,15 @@ off_t file_read_at(struct file *file, void *buffer, off_t size, off_t file_ofs)
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
    not yet implemented.)
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   If FILE is the write end of a pipe, waits for room and returns
+   less than SIZE only once every read end is closed; if it is the
+   read end, returns -1. */
 off_t file_write(struct file *file, const void *buffer, off_t size)
 {
+    if (file->pipe != NULL)
+        return file->write_end ? pipe_write(file->pipe, buffer, size) : -1;
+
     off_t bytes_written = inode_write_at(file->inode, buffer, size, file->pos);
     file->pos += bytes_written;
     return bytes_written;
@@ -98,10 +169,13 @@ off_t file_write(struct file *file, const void *buffer, off_t size)
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
    not yet implemented.)
-   The file's current position is unaffected. */
+   The file's current position is unaffected.
+   Returns -1 if FILE is a pipe. */
 off_t file_write_at(struct file *file, const void *buffer, off_t size,
                     off_t file_ofs)
 {
+    if (file->pipe != NULL)
+        return -1;
     return inode_write_at(file->inode, buffer, size, file_ofs);
 }
 
@@ -130,10 +204,12 @@ void file_allow_write(struct file *file)
     }
 }
 
-/* Returns the size of FILE in bytes. */
+/* Returns the size of FILE in bytes, which is 0 for a pipe. */
 off_t file_length(struct file *file)
 {
     ASSERT(file != NULL);
+    if (file->pipe != NULL)
+        return 0;
     return inode_length(file->inode);
 }
 
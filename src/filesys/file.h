@@ -1,15 +1,20 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
 
 struct inode;
+struct pipe;
 
 /* Opening and closing files. */
 struct file *file_open(struct inode *);
+struct file *file_open_pipe(struct pipe *, bool write_end);
 struct file *file_reopen(struct file *);
+struct file *file_dup(struct file *);
 void file_close(struct file *);
 struct inode *file_get_inode(struct file *);
+bool file_is_pipe(struct file *);
 
 /* Reading and writing. */
 off_t file_read(struct file *, void *, off_t);
@@ -2,10 +2,12 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/pipe.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
@@ -20,7 +22,9 @@ void filesys_init(bool format)
     if (fs_device == NULL)
         PANIC("No file system device found, can't initialize file system.");
 
+    cache_init();
     inode_init();
+    pipe_init();
     free_map_init();
 
     if (format)
@@ -34,6 +38,7 @@ void filesys_init(bool format)
 void filesys_done(void)
 {
     free_map_close();
+    cache_flush();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -3,9 +3,11 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -27,14 +29,23 @@ static inline size_t bytes_to_sectors(off_t size)
     return DIV_ROUND_UP(size, BLOCK_SECTOR_SIZE);
 }
 
-/* In-memory inode. */
+/* In-memory inode.
+
+   Reads take no lock: the basic file system never resizes or
+   moves a file's data, and the buffer cache copies each sector
+   in or out atomically.  Writes to one inode are serialized by
+   its lock, so that two writes' sectors do not interleave, but
+   inodes are otherwise independent. */
 struct inode
 {
     struct list_elem elem;  /* Element in inode list. */
     block_sector_t sector;  /* Sector number of disk location. */
-    int open_cnt;           /* Number of openers. */
+    int open_cnt;           /* Number of openers, under open_inodes_lock. */
     bool removed;           /* True if deleted, false otherwise. */
+    struct lock lock;       /* Protects the write counts, serializes writes. */
     int deny_write_cnt;     /* 0: writes ok, >0: deny writes. */
+    unsigned write_cnt;     /* Number of writes that changed data. */
+    struct lock dir_lock;   /* Serializes directory operations. */
     struct inode_disk data; /* Inode content. */
 };
 
@@ -55,10 +66,14 @@ static block_sector_t byte_to_sector(const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and every inode's open_cnt. */
+static struct lock open_inodes_lock;
+
 /* Initializes the inode module. */
 void inode_init(void)
 {
     list_init(&open_inodes);
+    lock_init(&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -85,14 +100,15 @@ bool inode_create(block_sector_t sector, off_t length)
         disk_inode->magic = INODE_MAGIC;
         if (free_map_allocate(sectors, &disk_inode->start))
         {
-            block_write(fs_device, sector, disk_inode);
+            cache_write(sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
             if (sectors > 0)
             {
                 static char zeros[BLOCK_SECTOR_SIZE];
                 size_t i;
 
                 for (i = 0; i < sectors; i++)
-                    block_write(fs_device, disk_inode->start + i, zeros);
+                    cache_write(disk_inode->start + i, zeros, 0,
+                                BLOCK_SECTOR_SIZE);
             }
             success = true;
         }
@@ -109,6 +125,8 @@ struct inode *inode_open(block_sector_t sector)
     struct list_elem *e;
     struct inode *inode;
 
+    lock_acquire(&open_inodes_lock);
+
     /* Check whether this inode is already open. */
     for (e = list_begin(&open_inodes); e != list_end(&open_inodes);
          e = list_next(e))
@@ -116,7 +134,8 @@ struct inode *inode_open(block_sector_t sector)
         inode = list_entry(e, struct inode, elem);
         if (inode->sector == sector)
         {
-            inode_reopen(inode);
+            inode->open_cnt++;
+            lock_release(&open_inodes_lock);
             return inode;
         }
     }
@@ -124,15 +143,23 @@ struct inode *inode_open(block_sector_t sector)
     /* Allocate memory. */
     inode = malloc(sizeof *inode);
     if (inode == NULL)
+    {
+        lock_release(&open_inodes_lock);
         return NULL;
+    }
 
-    /* Initialize. */
+    /* Initialize.  The inode is read from disk with the lock held,
+       so that nobody can use it before it is filled in. */
     list_push_front(&open_inodes, &inode->elem);
     inode->sector = sector;
     inode->open_cnt = 1;
     inode->deny_write_cnt = 0;
+    inode->write_cnt = 0;
     inode->removed = false;
-    block_read(fs_device, inode->sector, &inode->data);
+    lock_init(&inode->lock);
+    lock_init(&inode->dir_lock);
+    cache_read(inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+    lock_release(&open_inodes_lock);
     return inode;
 }
 
@@ -140,7 +167,11 @@ struct inode *inode_open(block_sector_t sector)
 struct inode *inode_reopen(struct inode *inode)
 {
     if (inode != NULL)
+    {
+        lock_acquire(&open_inodes_lock);
         inode->open_cnt++;
+        lock_release(&open_inodes_lock);
+    }
     return inode;
 }
 
@@ -155,16 +186,21 @@ block_sector_t inode_get_inumber(const struct inode *inode)
    If INODE was also a removed inode, frees its blocks. */
 void inode_close(struct inode *inode)
 {
+    bool last;
+
     /* Ignore null pointer. */
     if (inode == NULL)
         return;
 
-    /* Release resources if this was the last opener. */
-    if (--inode->open_cnt == 0)
-    {
-        /* Remove from inode list and release lock. */
+    lock_acquire(&open_inodes_lock);
+    last = --inode->open_cnt == 0;
+    if (last)
         list_remove(&inode->elem);
+    lock_release(&open_inodes_lock);
 
+    /* Release resources if this was the last opener. */
+    if (last)
+    {
         /* Deallocate blocks if removed. */
         if (inode->removed)
         {
@@ -177,6 +213,13 @@ void inode_close(struct inode *inode)
     }
 }
 
+/* Returns true if INODE has been removed, in which case it can no
+   longer be opened by name. */
+bool inode_is_removed(const struct inode *inode)
+{
+    return inode->removed;
+}
+
 /* Marks INODE to be deleted when it is closed by the last caller who
    has it open. */
 void inode_remove(struct inode *inode)
@@ -192,7 +235,6 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
 {
     uint8_t *buffer = buffer_;
     off_t bytes_read = 0;
-    uint8_t *bounce = NULL;
 
     while (size > 0)
     {
@@ -210,31 +252,13 @@ off_t inode_read_at(struct inode *inode, void *buffer_, off_t size, off_t offset
         if (chunk_size <= 0)
             break;
 
-        if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-            /* Read full sector directly into caller's buffer. */
-            block_read(fs_device, sector_idx, buffer + bytes_read);
-        }
-        else
-        {
-            /* Read sector into bounce buffer, then partially copy
-               into caller's buffer. */
-            if (bounce == NULL)
-            {
-                bounce = malloc(BLOCK_SECTOR_SIZE);
-                if (bounce == NULL)
-                    break;
-            }
-            block_read(fs_device, sector_idx, bounce);
-            memcpy(buffer + bytes_read, bounce + sector_ofs, chunk_size);
-        }
+        cache_read(sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
 
         /* Advance. */
         size -= chunk_size;
         offset += chunk_size;
         bytes_read += chunk_size;
     }
-    free(bounce);
 
     return bytes_read;
 }
@@ -249,10 +273,13 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
 {
     const uint8_t *buffer = buffer_;
     off_t bytes_written = 0;
-    uint8_t *bounce = NULL;
 
+    lock_acquire(&inode->lock);
     if (inode->deny_write_cnt)
+    {
+        lock_release(&inode->lock);
         return 0;
+    }
 
     while (size > 0)
     {
@@ -270,38 +297,16 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
         if (chunk_size <= 0)
             break;
 
-        if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-            /* Write full sector directly to disk. */
-            block_write(fs_device, sector_idx, buffer + bytes_written);
-        }
-        else
-        {
-            /* We need a bounce buffer. */
-            if (bounce == NULL)
-            {
-                bounce = malloc(BLOCK_SECTOR_SIZE);
-                if (bounce == NULL)
-                    break;
-            }
-
-            /* If the sector contains data before or after the chunk
-               we're writing, then we need to read in the sector
-               first.  Otherwise we start with a sector of all zeros. */
-            if (sector_ofs > 0 || chunk_size < sector_left)
-                block_read(fs_device, sector_idx, bounce);
-            else
-                memset(bounce, 0, BLOCK_SECTOR_SIZE);
-            memcpy(bounce + sector_ofs, buffer + bytes_written, chunk_size);
-            block_write(fs_device, sector_idx, bounce);
-        }
+        cache_write(sector_idx, buffer + bytes_written, sector_ofs, chunk_size);
 
         /* Advance. */
         size -= chunk_size;
         offset += chunk_size;
         bytes_written += chunk_size;
     }
-    free(bounce);
+    if (bytes_written > 0)
+        inode->write_cnt++;
+    lock_release(&inode->lock);
 
     return bytes_written;
 }
@@ -310,8 +315,10 @@ off_t inode_write_at(struct inode *inode, const void *buffer_, off_t size,
    May be called at most once per inode opener. */
 void inode_deny_write(struct inode *inode)
 {
+    lock_acquire(&inode->lock);
     inode->deny_write_cnt++;
     ASSERT(inode->deny_write_cnt <= inode->open_cnt);
+    lock_release(&inode->lock);
 }
 
 /* Re-enables writes to INODE.
@@ -319,9 +326,32 @@ void inode_deny_write(struct inode *inode)
    inode_deny_write() on the inode, before closing the inode. */
 void inode_allow_write(struct inode *inode)
 {
+    lock_acquire(&inode->lock);
     ASSERT(inode->deny_write_cnt > 0);
     ASSERT(inode->deny_write_cnt <= inode->open_cnt);
     inode->deny_write_cnt--;
+    lock_release(&inode->lock);
+}
+
+/* Acquires INODE's directory lock, which serializes lookups and
+   updates of the directory INODE holds. */
+void inode_lock_dir(struct inode *inode)
+{
+    lock_acquire(&inode->dir_lock);
+}
+
+/* Releases INODE's directory lock. */
+void inode_unlock_dir(struct inode *inode)
+{
+    lock_release(&inode->dir_lock);
+}
+
+/* Returns the number of writes that have changed INODE's data
+   since it was opened.  For as long as the caller keeps INODE
+   open, an unchanged count means unchanged data. */
+unsigned inode_write_cnt(const struct inode *inode)
+{
+    return inode->write_cnt;
 }
 
 /* Returns the length, in bytes, of INODE's data. */
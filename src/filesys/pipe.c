@@ -0,0 +1,217 @@
+#include "filesys/pipe.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+
+/* Capacity of a pipe's buffer, in bytes. */
+#define PIPE_SIZE PGSIZE
+
+/* An in-memory pipe: a page-sized ring buffer with a read end and
+   a write end.  Readers block while it is empty and writers while
+   it is full, unless their process is being terminated. */
+struct pipe
+{
+    struct list_elem elem;     /* Element in `all_pipes'. */
+    struct lock lock;          /* Protects all the members. */
+    struct condition readable; /* Signaled when data or EOF arrives. */
+    struct condition writable; /* Signaled when space frees up. */
+    uint8_t *buffer;           /* PIPE_SIZE bytes of data. */
+    size_t head;               /* Offset of the first byte to read. */
+    size_t used;               /* Number of bytes in BUFFER. */
+    int readers;               /* Open read ends. */
+    int writers;               /* Open write ends. */
+};
+
+/* Every pipe that is open, so that pipe_wakeup_all() can find
+   the waiters.  Protected by all_pipes_lock. */
+static struct list all_pipes;
+static struct lock all_pipes_lock;
+
+/* Initializes the pipe module. */
+void pipe_init(void)
+{
+    list_init(&all_pipes);
+    lock_init(&all_pipes_lock);
+}
+
+/* Creates a new pipe and opens both of its ends, storing the read
+   end in *READ_END and the write end in *WRITE_END.  Returns false
+   if memory cannot be allocated. */
+bool pipe_open(struct file **read_end, struct file **write_end)
+{
+    struct pipe *p = malloc(sizeof *p);
+    if (p == NULL)
+        return false;
+
+    p->buffer = palloc_get_page(0);
+    if (p->buffer == NULL)
+    {
+        free(p);
+        return false;
+    }
+
+    lock_init(&p->lock);
+    cond_init(&p->readable);
+    cond_init(&p->writable);
+    p->head = 0;
+    p->used = 0;
+    p->readers = 1;
+    p->writers = 1;
+    lock_acquire(&all_pipes_lock);
+    list_push_back(&all_pipes, &p->elem);
+    lock_release(&all_pipes_lock);
+
+    *read_end = file_open_pipe(p, false);
+    *write_end = file_open_pipe(p, true);
+    if (*read_end == NULL || *write_end == NULL)
+    {
+        /* Closing the ends that were opened releases the pipe once
+           its counts reach zero. */
+        if (*read_end == NULL)
+            pipe_close(p, false);
+        if (*write_end == NULL)
+            pipe_close(p, true);
+        file_close(*read_end);
+        file_close(*write_end);
+        return false;
+    }
+
+    return true;
+}
+
+/* Reads up to SIZE bytes from pipe P into BUFFER, waiting until at
+   least one byte is available.  Returns the number of bytes read,
+   which is 0 only at end of file, once every write end is closed
+   and the pipe is empty, or if the process is being terminated. */
+off_t pipe_read(struct pipe *p, void *buffer_, off_t size)
+{
+    uint8_t *buffer = buffer_;
+    off_t bytes_read = 0;
+
+    lock_acquire(&p->lock);
+    while (p->used == 0 && p->writers > 0 && size > 0 && !process_exiting())
+        cond_wait(&p->readable, &p->lock);
+
+    /* Copy out in at most two pieces, for the wrap-around. */
+    while (bytes_read < size && p->used > 0)
+    {
+        size_t chunk = PIPE_SIZE - p->head;
+        if (chunk > p->used)
+            chunk = p->used;
+        if (chunk > (size_t)(size - bytes_read))
+            chunk = size - bytes_read;
+
+        memcpy(buffer + bytes_read, p->buffer + p->head, chunk);
+        p->head = (p->head + chunk) % PIPE_SIZE;
+        p->used -= chunk;
+        bytes_read += chunk;
+    }
+
+    if (bytes_read > 0)
+        cond_broadcast(&p->writable, &p->lock);
+    lock_release(&p->lock);
+
+    return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into pipe P, waiting for space as
+   needed.  A write of at most PIPE_BUF bytes goes in all at once.
+   Returns the number of bytes written, which is less than SIZE
+   only if every read end is closed or the process is being
+   terminated, or -1 if nothing was written. */
+off_t pipe_write(struct pipe *p, const void *buffer_, off_t size)
+{
+    const uint8_t *buffer = buffer_;
+    off_t bytes_written = 0;
+
+    lock_acquire(&p->lock);
+    while (bytes_written < size && p->readers > 0)
+    {
+        size_t left = size - bytes_written;
+        size_t need = left <= PIPE_BUF ? left : 1;
+
+        if (PIPE_SIZE - p->used < need)
+        {
+            if (process_exiting())
+                break;
+            cond_wait(&p->writable, &p->lock);
+            continue;
+        }
+
+        /* Fill the free space up to the end of the buffer. */
+        size_t tail = (p->head + p->used) % PIPE_SIZE;
+        size_t chunk = PIPE_SIZE - p->used;
+        if (chunk > PIPE_SIZE - tail)
+            chunk = PIPE_SIZE - tail;
+        if (chunk > left)
+            chunk = left;
+
+        memcpy(p->buffer + tail, buffer + bytes_written, chunk);
+        p->used += chunk;
+        bytes_written += chunk;
+        cond_broadcast(&p->readable, &p->lock);
+    }
+
+    if (bytes_written == 0 && size > 0)
+        bytes_written = -1;
+    lock_release(&p->lock);
+
+    return bytes_written;
+}
+
+/* Closes one end of pipe P, the write end if WRITE_END is true or
+   the read end otherwise, waking any process blocked on the other
+   end.  Frees P once both ends are closed. */
+void pipe_close(struct pipe *p, bool write_end)
+{
+    bool last;
+
+    lock_acquire(&p->lock);
+    if (write_end)
+    {
+        ASSERT(p->writers > 0);
+        p->writers--;
+        cond_broadcast(&p->readable, &p->lock);
+    }
+    else
+    {
+        ASSERT(p->readers > 0);
+        p->readers--;
+        cond_broadcast(&p->writable, &p->lock);
+    }
+    last = p->readers == 0 && p->writers == 0;
+    lock_release(&p->lock);
+
+    if (last)
+    {
+        lock_acquire(&all_pipes_lock);
+        list_remove(&p->elem);
+        lock_release(&all_pipes_lock);
+        palloc_free_page(p->buffer);
+        free(p);
+    }
+}
+
+/* Wakes every thread blocked on a pipe, so that the threads of a
+   process being terminated notice and give up. */
+void pipe_wakeup_all(void)
+{
+    lock_acquire(&all_pipes_lock);
+    for (struct list_elem *e = list_begin(&all_pipes); e != list_end(&all_pipes);
+         e = list_next(e))
+    {
+        struct pipe *p = list_entry(e, struct pipe, elem);
+
+        lock_acquire(&p->lock);
+        cond_broadcast(&p->readable, &p->lock);
+        cond_broadcast(&p->writable, &p->lock);
+        lock_release(&p->lock);
+    }
+    lock_release(&all_pipes_lock);
+}
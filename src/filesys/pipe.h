@@ -0,0 +1,21 @@
+#ifndef FILESYS_PIPE_H
+#define FILESYS_PIPE_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct pipe;
+
+/* Writes of at most this many bytes are never interleaved with
+   other writes to the same pipe. */
+#define PIPE_BUF 512
+
+void pipe_init(void);
+bool pipe_open(struct file **read_end, struct file **write_end);
+off_t pipe_read(struct pipe *, void *, off_t);
+off_t pipe_write(struct pipe *, const void *, off_t);
+void pipe_close(struct pipe *, bool write_end);
+void pipe_wakeup_all(void);
+
+#endif /* filesys/pipe.h */
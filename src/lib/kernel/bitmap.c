@@ -342,6 +342,28 @@ bool bitmap_write(const struct bitmap *b, struct file *file)
     off_t size = byte_cnt(b->bit_cnt);
     return file_write_at(file, b->bits, size, 0) == size;
 }
+
+/* Writes the elements of B that hold the CNT bits starting at
+   START to FILE, where bitmap_write() would put them, leaving the
+   rest of FILE alone.  Return true if successful, false
+   otherwise. */
+bool bitmap_write_range(const struct bitmap *b, struct file *file,
+                        size_t start, size_t cnt)
+{
+    size_t first, last;
+    off_t ofs, size;
+
+    ASSERT(start <= b->bit_cnt);
+    ASSERT(start + cnt <= b->bit_cnt);
+
+    if (cnt == 0)
+        return true;
+    first = elem_idx(start);
+    last = elem_idx(start + cnt - 1);
+    ofs = first * sizeof(elem_type);
+    size = (last - first + 1) * sizeof(elem_type);
+    return file_write_at(file, b->bits + first, size, ofs) == size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -142,8 +142,9 @@ int puts(const char *s)
 void putbuf(const char *buffer, size_t n)
 {
     acquire_console();
-    while (n-- > 0)
-        putchar_have_lock(*buffer++);
+    write_cnt += n;
+    serial_putbuf((const uint8_t *)buffer, n);
+    vga_putbuf(buffer, n);
     release_console();
 }
 
@@ -0,0 +1,25 @@
+#ifndef __LIB_SPAWN_H
+#define __LIB_SPAWN_H
+
+/* Kinds of file action for spawn(). */
+enum spawn_action_type
+{
+   SPAWN_DUP,   /* Make FD in the child refer to the parent's SRC_FD. */
+   SPAWN_OPEN,  /* Open PATH as FD in the child. */
+   SPAWN_CLOSE  /* Close FD in the child. */
+};
+
+/* A file action for spawn().  A child starts with all of its
+   parent's file descriptors, then applies its actions in order. */
+struct spawn_action
+{
+   enum spawn_action_type type;
+   int fd;           /* Child's file descriptor. */
+   int src_fd;       /* Parent's file descriptor, for SPAWN_DUP. */
+   const char *path; /* File name, for SPAWN_OPEN. */
+};
+
+/* Maximum number of actions in one spawn() call. */
+#define SPAWN_ACTION_MAX 16
+
+#endif /* lib/spawn.h */
@@ -47,7 +47,41 @@ enum
     /* Reads a directory entry. */
     SYS_ISDIR,
     /* Tests if a fd represents a directory. */
-    SYS_INUMBER /* Returns the inode number for a fd. */
+    SYS_INUMBER,
+    /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_PREAD,
+    /* Read from a file at a given position. */
+    SYS_PWRITE,
+    /* Write to a file at a given position. */
+    SYS_READV,
+    /* Read from a file into several buffers. */
+    SYS_WRITEV,
+    /* Write to a file from several buffers. */
+    SYS_COPY_FILE_RANGE,
+    /* Copy data between files in the kernel. */
+    SYS_SPAWN,
+    /* Start another process with given files. */
+    SYS_PIPE,
+    /* Create a pipe. */
+    SYS_SHM_OPEN,
+    /* Create or look up a shared memory segment. */
+    SYS_SHM_ATTACH,
+    /* Map a shared memory segment. */
+    SYS_SHM_DETACH,
+    /* Unmap a shared memory segment. */
+    SYS_SHM_UNLINK,
+    /* Remove a shared memory segment's name. */
+    SYS_THREAD_CREATE,
+    /* Start another thread in the process. */
+    SYS_THREAD_JOIN,
+    /* Wait for a thread to exit. */
+    SYS_THREAD_EXIT,
+    /* Exit the current thread. */
+    SYS_FUTEX_WAIT,
+    /* Sleep while a word holds a value. */
+    SYS_FUTEX_WAKE /* Wake threads sleeping on a word. */
 };
 
 #endif /* lib/syscall-nr.h */
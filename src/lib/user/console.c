@@ -3,6 +3,28 @@
 #include <syscall.h>
 #include <syscall-nr.h>
 
+/* Buffered standard output.  Output to STDOUT_FILENO collects
+   here and is written in a single system call when a call that
+   wrote a new-line returns, when the buffer fills up, before
+   reading the console, and before halt, exec, and exit.  The
+   buffer is shared by the process's threads and protected by
+   stdout_lock. */
+static char stdout_buf[512];
+static size_t stdout_cnt;
+static bool stdout_newline; /* New-line buffered since last flush? */
+
+/* Futex-based lock: 0 if free, 1 if held, 2 if held and another
+   thread may be waiting for it.  An uncontended lock costs no
+   system call. */
+static int stdout_lock;
+
+static void stdout_acquire(void);
+static void stdout_release(void);
+static void stdout_putc(char);
+static void stdout_add_char(char, void *);
+static void stdout_flush_line(void);
+static void stdout_flush(void);
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list. */
 int vprintf(const char *format, va_list args)
@@ -27,8 +49,12 @@ int hprintf(int handle, const char *format, ...)
    character. */
 int puts(const char *s)
 {
-    write(STDOUT_FILENO, s, strlen(s));
-    putchar('\n');
+    stdout_acquire();
+    while (*s != '\0')
+        stdout_putc(*s++);
+    stdout_putc('\n');
+    stdout_flush_line();
+    stdout_release();
 
     return 0;
 }
@@ -36,11 +62,96 @@ int puts(const char *s)
 /* Writes C to the console. */
 int putchar(int c)
 {
-    char c2 = c;
-    write(STDOUT_FILENO, &c2, 1);
+    stdout_acquire();
+    stdout_putc(c);
+    stdout_flush_line();
+    stdout_release();
     return c;
 }
 
+/* Writes out any buffered standard output. */
+void console_flush(void)
+{
+    /* An empty buffer needs no lock.  Checking first also keeps the
+       write() in stdout_flush(), which calls us with the buffer
+       already emptied, from taking the lock a second time. */
+    if (stdout_cnt == 0)
+        return;
+
+    stdout_acquire();
+    stdout_flush();
+    stdout_release();
+}
+
+/* Acquires stdout_lock, sleeping on it while another thread holds
+   it. */
+static void stdout_acquire(void)
+{
+    int c = __sync_val_compare_and_swap(&stdout_lock, 0, 1);
+
+    if (c == 0)
+        return;
+    if (c != 2)
+        c = __sync_lock_test_and_set(&stdout_lock, 2);
+    while (c != 0)
+    {
+        futex_wait(&stdout_lock, 2);
+        c = __sync_lock_test_and_set(&stdout_lock, 2);
+    }
+}
+
+/* Releases stdout_lock, waking a waiting thread if there may be
+   one. */
+static void stdout_release(void)
+{
+    if (__sync_fetch_and_sub(&stdout_lock, 1) != 1)
+    {
+        __sync_lock_release(&stdout_lock);
+        futex_wake(&stdout_lock, 1);
+    }
+}
+
+/* Writes out the standard output buffer.  stdout_lock must be
+   held. */
+static void stdout_flush(void)
+{
+    size_t cnt = stdout_cnt;
+
+    /* Empty the buffer first, because write() flushes it too. */
+    stdout_cnt = 0;
+    stdout_newline = false;
+    if (cnt > 0)
+        write(STDOUT_FILENO, stdout_buf, cnt);
+}
+
+/* Adds C to the standard output buffer, flushing it first if it
+   is full.  stdout_lock must be held. */
+static void stdout_putc(char c)
+{
+    if (stdout_cnt >= sizeof stdout_buf)
+        stdout_flush();
+    stdout_buf[stdout_cnt++] = c;
+    if (c == '\n')
+        stdout_newline = true;
+}
+
+/* __vprintf() helper that adds C to the standard output buffer
+   and counts it in the int that CNT points to. */
+static void stdout_add_char(char c, void *cnt_)
+{
+    int *cnt = cnt_;
+    stdout_putc(c);
+    (*cnt)++;
+}
+
+/* Flushes the standard output buffer if it holds a complete
+   line.  stdout_lock must be held. */
+static void stdout_flush_line(void)
+{
+    if (stdout_newline)
+        stdout_flush();
+}
+
 /* Auxiliary data for vhprintf_helper(). */
 struct vhprintf_aux
 {
@@ -59,6 +170,17 @@ static void flush(struct vhprintf_aux *);
 int vhprintf(int handle, const char *format, va_list args)
 {
     struct vhprintf_aux aux;
+
+    if (handle == STDOUT_FILENO)
+    {
+        int char_cnt = 0;
+        stdout_acquire();
+        __vprintf(format, args, stdout_add_char, &char_cnt);
+        stdout_flush_line();
+        stdout_release();
+        return char_cnt;
+    }
+
     aux.p = aux.buf;
     aux.char_cnt = 0;
     aux.handle = handle;
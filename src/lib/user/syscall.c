@@ -1,4 +1,5 @@
 #include <syscall.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
 /* Invokes syscall NUMBER, passing no arguments, and returns the
@@ -57,20 +58,41 @@
     retval;                                                      \
   })
 
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                 \
+  ({                                                             \
+    int retval;                                                  \
+    asm volatile("pushl %[arg3]; pushl %[arg2]; "                \
+                 "pushl %[arg1]; pushl %[arg0]; "                \
+                 "pushl %[number]; int $0x30; addl $20, %%esp"   \
+                 : "=a"(retval)                                  \
+                 : [ number ] "i"(NUMBER),                       \
+                   [ arg0 ] "r"(ARG0),                           \
+                   [ arg1 ] "r"(ARG1),                           \
+                   [ arg2 ] "r"(ARG2),                           \
+                   [ arg3 ] "g"(ARG3)                            \
+                 : "memory");                                    \
+    retval;                                                      \
+  })
+
 void halt(void)
 {
+  console_flush();
   syscall0(SYS_HALT);
   NOT_REACHED();
 }
 
 void exit(int status)
 {
+  console_flush();
   syscall1(SYS_EXIT, status);
   NOT_REACHED();
 }
 
 pid_t exec(const char *file)
 {
+  console_flush();
   return (pid_t)syscall1(SYS_EXEC, file);
 }
 
@@ -101,11 +123,15 @@ int filesize(int fd)
 
 int read(int fd, void *buffer, unsigned size)
 {
+  if (fd == STDIN_FILENO)
+    console_flush();
   return syscall3(SYS_READ, fd, buffer, size);
 }
 
 int write(int fd, const void *buffer, unsigned size)
 {
+  if (fd == STDOUT_FILENO)
+    console_flush();
   return syscall3(SYS_WRITE, fd, buffer, size);
 }
 
@@ -158,3 +184,98 @@ int inumber(int fd)
 {
   return syscall1(SYS_INUMBER, fd);
 }
+
+int pread(int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4(SYS_PREAD, fd, buffer, size, offset);
+}
+
+int pwrite(int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4(SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int readv(int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3(SYS_READV, fd, iov, iovcnt);
+}
+
+int writev(int fd, const struct iovec *iov, int iovcnt)
+{
+  if (fd == STDOUT_FILENO)
+    console_flush();
+  return syscall3(SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int copy_file_range(int fd_in, int fd_out, unsigned length)
+{
+  if (fd_out == STDOUT_FILENO)
+    console_flush();
+  return syscall3(SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
+
+pid_t spawn(const char *cmd_line, const struct spawn_action *actions, int action_cnt)
+{
+  console_flush();
+  return (pid_t)syscall3(SYS_SPAWN, cmd_line, actions, action_cnt);
+}
+
+int pipe(int fds[2])
+{
+  return syscall1(SYS_PIPE, fds);
+}
+
+int shm_open(const char *name, unsigned size)
+{
+  return syscall2(SYS_SHM_OPEN, name, size);
+}
+
+bool shm_attach(int shmid, void *addr)
+{
+  return syscall2(SYS_SHM_ATTACH, shmid, addr);
+}
+
+bool shm_detach(void *addr)
+{
+  return syscall1(SYS_SHM_DETACH, addr);
+}
+
+bool shm_unlink(const char *name)
+{
+  return syscall1(SYS_SHM_UNLINK, name);
+}
+
+/* Runs FUNC(AUX) in a new thread, then exits the thread.  The
+   kernel starts every thread created by thread_create() here. */
+static void thread_start(void (*func)(void *aux), void *aux)
+{
+  func(aux);
+  thread_exit();
+}
+
+tid_t thread_create(void (*func)(void *aux), void *aux)
+{
+  return syscall3(SYS_THREAD_CREATE, thread_start, func, aux);
+}
+
+int thread_join(tid_t tid)
+{
+  return syscall1(SYS_THREAD_JOIN, tid);
+}
+
+void thread_exit(void)
+{
+  console_flush();
+  syscall0(SYS_THREAD_EXIT);
+  NOT_REACHED();
+}
+
+bool futex_wait(const int *addr, int val)
+{
+  return syscall2(SYS_FUTEX_WAIT, addr, val);
+}
+
+int futex_wake(const int *addr, int cnt)
+{
+  return syscall2(SYS_FUTEX_WAKE, addr, cnt);
+}
@@ -3,11 +3,17 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <spawn.h>
+#include <uio.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t)-1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t)-1)
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t)-1)
@@ -45,4 +51,22 @@ bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
 
+/* Extensions. */
+int pread(int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite(int fd, const void *buffer, unsigned length, unsigned offset);
+int readv(int fd, const struct iovec *iov, int iovcnt);
+int writev(int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range(int fd_in, int fd_out, unsigned length);
+pid_t spawn(const char *cmd_line, const struct spawn_action *, int action_cnt);
+int pipe(int fds[2]);
+int shm_open(const char *name, unsigned size);
+bool shm_attach(int shmid, void *addr);
+bool shm_detach(void *addr);
+bool shm_unlink(const char *name);
+tid_t thread_create(void (*func)(void *aux), void *aux);
+int thread_join(tid_t);
+void thread_exit(void) NO_RETURN;
+bool futex_wait(const int *addr, int val);
+int futex_wake(const int *addr, int cnt);
+
 #endif /* lib/user/syscall.h */
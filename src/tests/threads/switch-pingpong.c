@@ -0,0 +1,52 @@
+/* Measures the cost of a context switch by bouncing control
+   between two kernel threads with a pair of semaphores.
+
+   Both threads run on the base page directory, so a switch
+   between them should not need to reload CR3 or flush the TLB.
+   Compare the reported cycle counts across kernels, or with the
+   -nopge kernel option, to see the effect of TLB flushes. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of round trips between the two threads. */
+#define ROUND_TRIPS 10000
+
+static thread_func pong_thread;
+static struct semaphore ping, pong;
+
+void test_switch_pingpong(void)
+{
+    uint64_t start, cycles;
+    int i;
+
+    sema_init(&ping, 0);
+    sema_init(&pong, 0);
+    thread_create("pong", thread_get_priority(), pong_thread, NULL);
+
+    start = cpu_rdtsc();
+    for (i = 0; i < ROUND_TRIPS; i++)
+    {
+        sema_up(&ping);
+        sema_down(&pong);
+    }
+    cycles = cpu_rdtsc() - start;
+
+    msg("%d round trips, %" PRIu64 " cycles per switch.",
+        ROUND_TRIPS, cycles / (2 * ROUND_TRIPS));
+}
+
+static void pong_thread(void *aux UNUSED)
+{
+    int i;
+
+    for (i = 0; i < ROUND_TRIPS; i++)
+    {
+        sema_down(&ping);
+        sema_up(&pong);
+    }
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing cycle count in output\n"
+  unless grep (/^\(switch-pingpong\) \d+ round trips, \d+ cycles per switch\.$/,
+	       @output);
+
+pass;
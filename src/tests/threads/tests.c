@@ -38,6 +38,7 @@ static const struct test tests[] =
         {"mlfqs-nice-2", test_mlfqs_nice_2},
         {"mlfqs-nice-10", test_mlfqs_nice_10},
         {"mlfqs-block", test_mlfqs_block},
+        {"switch-pingpong", test_switch_pingpong},
 };
 
 static const char *test_name;
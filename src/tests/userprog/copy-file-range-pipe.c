@@ -0,0 +1,21 @@
+/* Tries to copy_file_range from the write end of a pipe, which
+   cannot be read, to the console and to a file. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void)
+{
+    int fds[2];
+    int out_fd;
+
+    CHECK(pipe(fds) == 0, "pipe");
+    CHECK(copy_file_range(fds[1], STDOUT_FILENO, 100) == -1,
+          "copy from write end to console");
+    CHECK(create("copy", 100), "create \"copy\"");
+    CHECK((out_fd = open("copy")) > 1, "open \"copy\"");
+    CHECK(copy_file_range(fds[1], out_fd, 100) == -1,
+          "copy from write end to \"copy\"");
+}
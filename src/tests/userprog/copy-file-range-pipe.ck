@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-file-range-pipe) begin
+(copy-file-range-pipe) pipe
+(copy-file-range-pipe) copy from write end to console
+(copy-file-range-pipe) create "copy"
+(copy-file-range-pipe) open "copy"
+(copy-file-range-pipe) copy from write end to "copy"
+(copy-file-range-pipe) end
+copy-file-range-pipe: exit(0)
+EOF
+pass;
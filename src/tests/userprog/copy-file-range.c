@@ -0,0 +1,24 @@
+/* Copies sample.txt to a new file and to the console with
+   copy_file_range. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void)
+{
+    int in_fd, out_fd;
+
+    CHECK((in_fd = open("sample.txt")) > 1, "open \"sample.txt\"");
+    CHECK(create("copy", sizeof sample - 1), "create \"copy\"");
+    CHECK((out_fd = open("copy")) > 1, "open \"copy\"");
+    CHECK(copy_file_range(in_fd, out_fd, 1000) == sizeof sample - 1,
+          "copy to \"copy\"");
+    check_file("copy", sample, sizeof sample - 1);
+
+    seek(in_fd, 0);
+    CHECK(copy_file_range(in_fd, STDOUT_FILENO, sizeof sample - 1) == sizeof sample - 1,
+          "copy to console");
+}
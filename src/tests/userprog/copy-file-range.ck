@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-file-range) begin
+(copy-file-range) open "sample.txt"
+(copy-file-range) create "copy"
+(copy-file-range) open "copy"
+(copy-file-range) copy to "copy"
+(copy-file-range) open "copy" for verification
+(copy-file-range) verified contents of "copy"
+(copy-file-range) close "copy"
+(copy-file-range) copy to console
+"Amazing Electronic Fact: If you scuffed your feet long enough without
+ touching anything, you would build up so many electrons that your
+ finger would explode!  But this is nothing to worry about unless you
+ have carpeting." --Dave Barry
+(copy-file-range) end
+copy-file-range: exit(0)
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Exercises pread, pwrite, readv, and writev. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void)
+{
+    char buf[sizeof sample];
+    struct iovec iov[3];
+    int fd;
+
+    CHECK(create("data", 16), "create \"data\"");
+    CHECK((fd = open("data")) > 1, "open \"data\"");
+    CHECK(pwrite(fd, "world", 5, 6) == 5, "pwrite at offset 6");
+    CHECK(pwrite(fd, "hello ", 6, 0) == 6, "pwrite at offset 0");
+    CHECK(tell(fd) == 0, "position unchanged");
+    CHECK(pread(fd, buf, 11, 0) == 11, "pread 11 bytes");
+    compare_bytes(buf, "hello world", 11, 0, "data");
+    CHECK(pread(STDIN_FILENO, buf, 1, 0) == -1, "pread from console fails");
+
+    CHECK((fd = open("sample.txt")) > 1, "open \"sample.txt\"");
+    iov[0].iov_base = buf;
+    iov[0].iov_len = 10;
+    iov[1].iov_base = buf + 10;
+    iov[1].iov_len = 0;
+    iov[2].iov_base = buf + 10;
+    iov[2].iov_len = sizeof buf - 10;
+    CHECK(readv(fd, iov, 3) == sizeof sample - 1, "readv 3 buffers");
+    compare_bytes(buf, sample, sizeof sample - 1, 0, "sample.txt");
+
+    iov[0].iov_base = "(io-vectored) writev ";
+    iov[0].iov_len = strlen(iov[0].iov_base);
+    iov[1].iov_base = "to ";
+    iov[1].iov_len = strlen(iov[1].iov_base);
+    iov[2].iov_base = "console\n";
+    iov[2].iov_len = strlen(iov[2].iov_base);
+    CHECK(writev(STDOUT_FILENO, iov, 3) == 32, "writev 3 buffers");
+}
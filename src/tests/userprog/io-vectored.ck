@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(io-vectored) begin
+(io-vectored) create "data"
+(io-vectored) open "data"
+(io-vectored) pwrite at offset 6
+(io-vectored) pwrite at offset 0
+(io-vectored) position unchanged
+(io-vectored) pread 11 bytes
+(io-vectored) pread from console fails
+(io-vectored) open "sample.txt"
+(io-vectored) readv 3 buffers
+(io-vectored) writev 3 buffers
+(io-vectored) writev to console
+(io-vectored) end
+io-vectored: exit(0)
+EOF
+pass;
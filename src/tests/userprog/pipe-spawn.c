@@ -0,0 +1,45 @@
+/* Writes to a pipe and reads the data back, then spawns a child
+   with its standard output connected to a pipe and reads the
+   child's output from the other end until end of file. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void)
+{
+    static const char expected[] = "(child-simple) run\n";
+    char buf[128];
+    int fds[2], cnt, total;
+    pid_t pid;
+
+    CHECK(pipe(fds) == 0, "pipe");
+    CHECK(write(fds[1], "hello", 5) == 5, "write \"hello\" to pipe");
+    CHECK(read(fds[0], buf, sizeof buf) == 5 && !memcmp(buf, "hello", 5),
+          "read \"hello\" from pipe");
+    close(fds[1]);
+    CHECK(read(fds[0], buf, sizeof buf) == 0, "read end of file from pipe");
+    close(fds[0]);
+
+    CHECK(pipe(fds) == 0, "pipe");
+    struct spawn_action actions[] = {
+        {.type = SPAWN_DUP, .fd = STDOUT_FILENO, .src_fd = fds[1]},
+        {.type = SPAWN_CLOSE, .fd = fds[0]},
+        {.type = SPAWN_CLOSE, .fd = fds[1]},
+    };
+    CHECK((pid = spawn("child-simple", actions, 3)) != PID_ERROR,
+          "spawn child-simple | pipe");
+    close(fds[1]);
+
+    total = 0;
+    while ((cnt = read(fds[0], buf + total, sizeof buf - total)) > 0)
+        total += cnt;
+    if (total != sizeof expected - 1 || memcmp(buf, expected, total))
+        fail("read %d bytes from pipe, expected \"%s\"", total, expected);
+    msg("read child's output from pipe");
+    close(fds[0]);
+
+    msg("wait(child-simple): %d", wait(pid));
+}
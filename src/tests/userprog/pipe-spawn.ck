@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-spawn) begin
+(pipe-spawn) pipe
+(pipe-spawn) write "hello" to pipe
+(pipe-spawn) read "hello" from pipe
+(pipe-spawn) read end of file from pipe
+(pipe-spawn) pipe
+(pipe-spawn) spawn child-simple | pipe
+child-simple: exit(81)
+(pipe-spawn) read child's output from pipe
+(pipe-spawn) wait(child-simple): 81
+(pipe-spawn) end
+pipe-spawn: exit(0)
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Opens "sample.txt" 1000 times, then times reads through the
+   last file descriptor, which should cost the same no matter how
+   many other files are open.  Also checks that a closed file
+   descriptor is the next one handed out. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 1000
+#define READ_CNT 1000
+
+/* Too big for the stack, which is a single page without VM. */
+static int fds[FILE_CNT];
+
+void test_main(void)
+{
+    uint64_t start, cycles;
+    char c;
+    int i;
+
+    for (i = 0; i < FILE_CNT; i++)
+    {
+        fds[i] = open("sample.txt");
+        if (fds[i] < 2)
+            fail("open #%d returned %d", i, fds[i]);
+    }
+    msg("opened %d files", FILE_CNT);
+
+    start = rdtsc();
+    for (i = 0; i < READ_CNT; i++)
+    {
+        seek(fds[FILE_CNT - 1], 0);
+        if (read(fds[FILE_CNT - 1], &c, 1) != 1)
+            fail("read #%d failed", i);
+    }
+    cycles = rdtsc() - start;
+    msg("seek+read on last fd: %llu cycles avg", cycles / READ_CNT);
+
+    close(fds[FILE_CNT / 2]);
+    CHECK(open("sample.txt") == fds[FILE_CNT / 2],
+          "reopen gets the lowest free fd");
+}
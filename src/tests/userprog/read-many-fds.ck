@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing read timing in output\n"
+  unless grep (/^\(read-many-fds\) seek\+read on last fd: \d+ cycles avg$/,
+	       @output);
+fail "lowest free fd was not reused\n"
+  if grep (/FAIL/, @output)
+     || !grep ($_ eq '(read-many-fds) reopen gets the lowest free fd', @output);
+
+pass;
@@ -0,0 +1,25 @@
+/* Invokes system calls with numbers that do not name a system
+   call.  Each must fail with a return value of -1 instead of
+   killing the process or the kernel. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Invokes system call NUMBER with no arguments and returns its
+   return value. */
+static int bad_syscall(int number)
+{
+    int retval;
+    asm volatile(
+        "pushl %[number]; int $0x30; addl $4, %%esp"
+        : "=a"(retval)
+        : [number] "g"(number)
+        : "memory");
+    return retval;
+}
+
+void test_main(void)
+{
+    CHECK(bad_syscall(1000) == -1, "syscall 1000");
+    CHECK(bad_syscall(-1) == -1, "syscall -1");
+}
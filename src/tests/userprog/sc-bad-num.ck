@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sc-bad-num) begin
+(sc-bad-num) syscall 1000
+(sc-bad-num) syscall -1
+(sc-bad-num) end
+sc-bad-num: exit(0)
+EOF
+pass;
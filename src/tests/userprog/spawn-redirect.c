@@ -0,0 +1,30 @@
+/* Spawns a child with its standard output redirected to a file
+   and checks the file's contents, then spawns a missing program
+   and checks that wait() reports its failure to load. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void)
+{
+    static const char expected[] = "(child-simple) run\n";
+    struct spawn_action action = {
+        .type = SPAWN_OPEN,
+        .fd = STDOUT_FILENO,
+        .path = "out",
+    };
+    pid_t pid;
+
+    CHECK(create("out", sizeof expected - 1), "create \"out\"");
+
+    CHECK((pid = spawn("child-simple", &action, 1)) != PID_ERROR,
+          "spawn child-simple > out");
+    msg("wait(child-simple): %d", wait(pid));
+    check_file("out", expected, sizeof expected - 1);
+
+    CHECK((pid = spawn("no-such-file", NULL, 0)) != PID_ERROR,
+          "spawn missing program");
+    msg("wait(no-such-file): %d", wait(pid));
+}
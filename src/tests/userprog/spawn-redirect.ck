@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(spawn-redirect) begin
+(spawn-redirect) create "out"
+(spawn-redirect) spawn child-simple > out
+child-simple: exit(81)
+(spawn-redirect) wait(child-simple): 81
+(spawn-redirect) open "out" for verification
+(spawn-redirect) verified contents of "out"
+(spawn-redirect) close "out"
+(spawn-redirect) spawn missing program
+load: no-such-file: open failed
+no-such-file: exit(-1)
+(spawn-redirect) wait(no-such-file): -1
+(spawn-redirect) end
+spawn-redirect: exit(0)
+EOF
+(spawn-redirect) begin
+(spawn-redirect) create "out"
+(spawn-redirect) spawn child-simple > out
+child-simple: exit(81)
+(spawn-redirect) wait(child-simple): 81
+(spawn-redirect) open "out" for verification
+(spawn-redirect) verified contents of "out"
+(spawn-redirect) close "out"
+(spawn-redirect) spawn missing program
+load: no-such-file: open failed
+(spawn-redirect) wait(no-such-file): -1
+(spawn-redirect) end
+spawn-redirect: exit(0)
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Has a thread block reading from an empty pipe while the initial
+   thread calls exit(), which must end the whole process rather
+   than wait for the reader forever. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int fds[2];
+static volatile int started;
+
+static void reader(void *aux UNUSED)
+{
+    char c;
+
+    started = 1;
+    read(fds[0], &c, 1);
+    fail("read returned");
+}
+
+void test_main(void)
+{
+    CHECK(pipe(fds) == 0, "pipe");
+    CHECK(thread_create(reader, NULL) != TID_ERROR, "thread_create");
+
+    /* Give the reader time to block in read(). */
+    while (!started)
+        continue;
+    for (volatile int i = 0; i < 100000; i++)
+        continue;
+
+    exit(57);
+}
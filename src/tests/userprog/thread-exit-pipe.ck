@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit-pipe) begin
+(thread-exit-pipe) pipe
+(thread-exit-pipe) thread_create
+thread-exit-pipe: exit(57)
+EOF
+pass;
@@ -0,0 +1,57 @@
+/* Starts several threads that increment a shared counter under a
+   lock built on futex_wait() and futex_wake(), joins them, and
+   checks that no increment was lost. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITERATIONS 1000
+
+static int lock;
+static int counter;
+
+static void acquire(void)
+{
+    while (__sync_lock_test_and_set(&lock, 1))
+        futex_wait(&lock, 1);
+}
+
+static void release(void)
+{
+    __sync_lock_release(&lock);
+    futex_wake(&lock, 1);
+}
+
+static void worker(void *aux)
+{
+    int *done = aux;
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        acquire();
+        counter++;
+        release();
+    }
+    *done = 1;
+}
+
+void test_main(void)
+{
+    tid_t tids[THREAD_CNT];
+    int done[THREAD_CNT] = {0};
+
+    for (int i = 0; i < THREAD_CNT; i++)
+        CHECK((tids[i] = thread_create(worker, &done[i])) != TID_ERROR,
+              "thread_create %d", i);
+    for (int i = 0; i < THREAD_CNT; i++)
+        CHECK(thread_join(tids[i]) == 0 && done[i], "thread_join %d", i);
+
+    if (counter != THREAD_CNT * ITERATIONS)
+        fail("counter is %d, expected %d", counter, THREAD_CNT * ITERATIONS);
+    msg("counter is %d", counter);
+
+    CHECK(thread_join(tids[0]) == -1, "thread_join 0 again");
+    CHECK(!futex_wait(&lock, 1), "futex_wait on changed value");
+}
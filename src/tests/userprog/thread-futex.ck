@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-futex) begin
+(thread-futex) thread_create 0
+(thread-futex) thread_create 1
+(thread-futex) thread_create 2
+(thread-futex) thread_create 3
+(thread-futex) thread_join 0
+(thread-futex) thread_join 1
+(thread-futex) thread_join 2
+(thread-futex) thread_join 3
+(thread-futex) counter is 4000
+(thread-futex) thread_join 0 again
+(thread-futex) futex_wait on changed value
+(thread-futex) end
+thread-futex: exit(0)
+EOF
+pass;
@@ -0,0 +1,23 @@
+/* Child process of shm-share.
+   Attaches the shared memory segment created by its parent at a
+   different address, checks the parent's data, and copies it
+   into the segment's second page. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *)0x20000000)
+
+void test_main(void)
+{
+    int shmid;
+
+    CHECK((shmid = shm_open("shared", 0)) != -1, "shm_open \"shared\"");
+    CHECK(shm_attach(shmid, ACTUAL), "shm_attach \"shared\"");
+    if (memcmp(ACTUAL, sample, sizeof sample))
+        fail("shared memory has bad data");
+    memcpy(ACTUAL + 4096, sample, sizeof sample);
+}
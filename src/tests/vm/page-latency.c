@@ -0,0 +1,52 @@
+/* Measures the latency of page faults under memory pressure.
+   Writes every page of a 2 MB buffer once, so that it no longer
+   fits in memory, then times the first write to each page on a
+   second pass and reports latency percentiles in CPU cycles.
+   With background page-out, most of these faults should not
+   have to write a dirty page out themselves. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+#define PAGE_CNT (SIZE / 4096)
+
+static char buf[SIZE];
+static uint64_t latency[PAGE_CNT];
+
+/* qsort() comparison function for uint64_t. */
+static int compare_u64(const void *a_, const void *b_)
+{
+    const uint64_t *a = a_;
+    const uint64_t *b = b_;
+
+    return *a < *b ? -1 : *a > *b;
+}
+
+void test_main(void)
+{
+    size_t i;
+
+    msg("dirty pass");
+    for (i = 0; i < PAGE_CNT; i++)
+        buf[i * 4096] = i;
+
+    msg("timed pass");
+    for (i = 0; i < PAGE_CNT; i++)
+    {
+        uint64_t start = rdtsc();
+        buf[i * 4096]++;
+        latency[i] = rdtsc() - start;
+    }
+
+    for (i = 0; i < PAGE_CNT; i++)
+        if (buf[i * 4096] != (char)(i + 1))
+            fail("page %zu has wrong contents", i);
+
+    qsort(latency, PAGE_CNT, sizeof *latency, compare_u64);
+    msg("fault latency (cycles): p50 %llu, p90 %llu, p99 %llu, max %llu",
+        latency[PAGE_CNT / 2], latency[PAGE_CNT * 9 / 10],
+        latency[PAGE_CNT * 99 / 100], latency[PAGE_CNT - 1]);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing fault latency in output\n"
+  unless grep (/^\(page-latency\) fault latency \(cycles\): p50 \d+, p90 \d+, p99 \d+, max \d+$/,
+	       @output);
+fail "page contents corrupted\n" if grep (/FAIL/, @output);
+
+pass;
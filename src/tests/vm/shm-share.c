@@ -0,0 +1,33 @@
+/* Creates a shared memory segment, writes to it, and runs
+   child-shm, which attaches the segment by name at a different
+   address, checks the data, and writes a reply.  Then checks the
+   reply and that unlinking removes the segment's name. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *)0x10000000)
+
+void test_main(void)
+{
+    int shmid;
+    pid_t child;
+
+    CHECK((shmid = shm_open("shared", 2 * 4096)) != -1, "shm_open \"shared\"");
+    CHECK(shm_attach(shmid, ACTUAL), "shm_attach \"shared\"");
+    memcpy(ACTUAL, sample, sizeof sample);
+
+    CHECK((child = exec("child-shm")) != -1, "exec \"child-shm\"");
+    quiet = true;
+    CHECK(wait(child) == 0, "wait for child");
+    quiet = false;
+
+    CHECK(!memcmp(ACTUAL + 4096, sample, sizeof sample),
+          "check data written by child");
+    CHECK(shm_unlink("shared"), "shm_unlink \"shared\"");
+    CHECK(shm_open("shared", 0) == -1, "shm_open \"shared\" after unlink");
+    CHECK(shm_detach(ACTUAL), "shm_detach \"shared\"");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-share) begin
+(shm-share) shm_open "shared"
+(shm-share) shm_attach "shared"
+(shm-share) exec "child-shm"
+(child-shm) begin
+(child-shm) shm_open "shared"
+(child-shm) shm_attach "shared"
+(child-shm) end
+child-shm: exit(0)
+(shm-share) check data written by child
+(shm-share) shm_unlink "shared"
+(shm-share) shm_open "shared" after unlink
+(shm-share) shm_detach "shared"
+(shm-share) end
+shm-share: exit(0)
+EOF
+pass;
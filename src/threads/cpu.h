@@ -0,0 +1,56 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdint.h>
+
+/* CPUID leaf 1 feature bits in EDX.
+   See [IA32-v2a] "CPUID". */
+#define CPUID_PSE 0x00000008 /* Page Size Extension. */
+#define CPUID_PGE 0x00002000 /* Page Global Enable. */
+
+/* CR4 Register.
+   See [IA32-v3a] 2.5 "Control Registers". */
+#define CR4_PSE 0x00000010 /* Page Size Extensions. */
+#define CR4_PGE 0x00000080 /* Page Global Enable. */
+
+/* Returns the EDX feature flags of CPUID leaf 1.
+   Every i686 implements CPUID. */
+static inline uint32_t cpu_features(void)
+{
+    uint32_t eax = 1, ebx, ecx = 0, edx;
+
+    /* See [IA32-v2a] "CPUID". */
+    asm volatile("cpuid"
+                 : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    return edx;
+}
+
+/* Returns the value of control register CR4. */
+static inline uint32_t cpu_read_cr4(void)
+{
+    uint32_t cr4;
+    asm volatile("movl %%cr4, %0"
+                 : "=r"(cr4));
+    return cr4;
+}
+
+/* Sets control register CR4 to CR4. */
+static inline void cpu_write_cr4(uint32_t cr4)
+{
+    asm volatile("movl %0, %%cr4"
+                 :
+                 : "r"(cr4)
+                 : "memory");
+}
+
+/* Returns the processor's time-stamp counter, which counts
+   clock cycles since reset.  See [IA32-v2b] "RDTSC". */
+static inline uint64_t cpu_rdtsc(void)
+{
+    uint64_t tsc;
+    asm volatile("rdtsc"
+                 : "=A"(tsc));
+    return tsc;
+}
+
+#endif /* threads/cpu.h */
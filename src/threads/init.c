@@ -15,6 +15,7 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -31,6 +32,13 @@
 #else
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
+#include "vm/wset.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
@@ -54,6 +62,12 @@ static const char *swap_bdev_name;
 #endif
 #endif /* FILESYS */
 
+/* -nopse: Map kernel memory with 4 kB pages only? */
+static bool no_pse;
+
+/* -nopge: Flush kernel mappings from the TLB on every CR3 load? */
+static bool no_pge;
+
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
@@ -99,6 +113,11 @@ int main(void)
     palloc_init(user_page_limit);
     malloc_init();
     paging_init();
+#ifdef VM
+    frame_init();
+    page_init();
+    shm_init();
+#endif
 
     /* Segmentation. */
 #ifdef USERPROG
@@ -121,6 +140,9 @@ int main(void)
     thread_start();
     serial_init_queue();
     timer_calibrate();
+#ifdef USERPROG
+    process_reaper_start();
+#endif
 
 #ifdef FILESYS
     /* Initialize file system. */
@@ -129,6 +151,12 @@ int main(void)
     filesys_init(format_filesys);
 #endif
 
+#ifdef VM
+    /* Initialize swap and start paging out in the background. */
+    swap_init();
+    frame_pageout_start();
+#endif
+
     printf("Boot complete.\n");
 
     /* Run actions specified on kernel command line. */
@@ -154,12 +182,25 @@ static void bss_init(void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports it and -nopse was not given, every 4 MB
+   region of RAM that lies entirely in memory and holds no kernel
+   text is mapped with a single large page.  That saves a page
+   table per region and lets one TLB entry cover all of it.
+
+   Kernel mappings are identical in every page directory, so they
+   are marked global.  Unless -nopge was given, they then survive
+   the CR3 reload on a process switch. */
 static void paging_init(void)
 {
     uint32_t *pd, *pt;
     size_t page;
     extern char _start, _end_kernel_text;
+    bool use_pse = !no_pse && (cpu_features() & CPUID_PSE) != 0;
+
+    if (use_pse)
+        cpu_write_cr4(cpu_read_cr4() | CR4_PSE);
 
     pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO);
     pt = NULL;
@@ -171,13 +212,21 @@ static void paging_init(void)
         size_t pte_idx = pt_no(vaddr);
         bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+        if (use_pse && pte_idx == 0 && page + PTSPAN / PGSIZE <= init_ram_pages
+            && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+            pd[pde_idx] = pde_create_large(vaddr, true) | PTE_G;
+            page += PTSPAN / PGSIZE - 1;
+            continue;
+        }
+
         if (pd[pde_idx] == 0)
         {
             pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
             pd[pde_idx] = pde_create(pt);
         }
 
-        pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text);
+        pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text) | PTE_G;
     }
 
     /* Store the physical address of the page directory into CR3
@@ -189,6 +238,10 @@ static void paging_init(void)
         "movl %0, %%cr3"
         :
         : "r"(vtop(init_page_dir)));
+
+    /* The global bits are ignored until CR4.PGE is set. */
+    if (!no_pge && (cpu_features() & CPUID_PGE) != 0)
+        cpu_write_cr4(cpu_read_cr4() | CR4_PGE);
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -257,9 +310,21 @@ static char **parse_options(char **argv)
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-nopse"))
+            no_pse = true;
+        else if (!strcmp(name, "-nopge"))
+            no_pge = true;
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
+        else if (!strcmp(name, "-pl"))
+            process_limit = atoi(value);
+#endif
+#ifdef VM
+        else if (!strcmp(name, "-sl"))
+            stack_page_limit = atoi(value);
+        else if (!strcmp(name, "-vmstats"))
+            wset_stats = true;
 #endif
         else
             PANIC("unknown option `%s' (use -h for help)", name);
@@ -379,8 +444,15 @@ static void usage(void)
 #endif
            "  -rs=SEED           Set random number seed to SEED.\n"
            "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+           "  -nopse             Map kernel memory with 4 kB pages only.\n"
+           "  -nopge             Do not keep kernel mappings in the TLB.\n"
 #ifdef USERPROG
            "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+           "  -pl=COUNT          Limit user processes to COUNT (default 256).\n"
+#endif
+#ifdef VM
+           "  -sl=COUNT          Limit each user stack to COUNT pages.\n"
+           "  -vmstats           Print paging statistics at process exit.\n"
 #endif
     );
     shutdown_power_off();
@@ -9,6 +9,10 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/process.h"
+#endif
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -383,6 +387,13 @@ void intr_handler(struct intr_frame *frame)
         if (yield_on_return)
             thread_yield();
     }
+
+#ifdef USERPROG
+    /* Returning to user mode.  The threads of a process that is
+       being terminated go no further. */
+    if (frame->cs == SEL_UCSEG)
+        process_return_to_user();
+#endif
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -68,6 +68,8 @@ static inline uintptr_t pd_no(const void *va)
 #define PTE_U 0x4            /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20           /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40           /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80          /* 1=4 MB page, 0=page table (PDEs only). */
+#define PTE_G 0x100          /* 1=global, kept in TLB across CR3 loads. */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create(uint32_t *pt)
@@ -76,11 +78,22 @@ static inline uint32_t pde_create(uint32_t *pt)
     return vtop(pt) | PTE_U | PTE_P | PTE_W;
 }
 
+/* Returns a PDE that maps the 4 MB region starting at kernel
+   virtual address PAGE directly, without a page table.  Requires
+   CR4.PSE.  The region is readable, writable if WRITABLE is true,
+   and usable only by ring 0 code (the kernel). */
+static inline uint32_t pde_create_large(void *page, bool writable)
+{
+    ASSERT(((uintptr_t)page & (PTSPAN - 1)) == 0);
+    return vtop(page) | PTE_PS | PTE_P | (writable ? PTE_W : 0);
+}
+
 /* Returns a pointer to the page table that page directory entry
-   PDE, which must "present", points to. */
+   PDE, which must "present" and not map a large page, points to. */
 static inline uint32_t *pde_get_pt(uint32_t pde)
 {
     ASSERT(pde & PTE_P);
+    ASSERT(!(pde & PTE_PS));
     return ptov(pde & PTE_ADDR);
 }
 
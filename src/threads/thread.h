@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include "fixed_point.h"
 
+struct page_table;
+
 /* States in a thread's life cycle. */
 enum thread_status
 {
@@ -125,6 +127,12 @@ struct thread
     uint32_t *pagedir;       /* Page directory. */
 #endif
 
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct page_table *pages; /* Supplemental page table. */
+    void *user_esp;           /* User stack pointer at last kernel entry. */
+#endif
+
     /* Owned by thread.c. */
     unsigned magic; /* Detects stack overflow. */
 };
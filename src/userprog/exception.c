@@ -4,10 +4,35 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "userprog/process.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include "threads/cpu.h"
+#include "vm/page.h"
+#include "vm/wset.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+#ifdef VM
+/* Page fault cost histogram buckets.  Bucket I counts faults
+   that took fewer than 1024 * 4**I cycles, except that the last
+   bucket counts all the rest. */
+#define FAULT_BUCKET_CNT 8
+
+/* Page faults of each type, and their cost in cycles. */
+static long long fault_cnt[FAULT_TYPE_CNT];
+static long long fault_cycles[FAULT_TYPE_CNT];
+static long long fault_hist[FAULT_TYPE_CNT][FAULT_BUCKET_CNT];
+
+static const char *fault_names[FAULT_TYPE_CNT] = {
+    "zero-map", "zero-fill", "file", "swap-in",
+    "cow", "stack", "minor", "invalid"};
+
+static void record_fault(enum fault_type, uint64_t cycles);
+#endif
+
 static void kill(struct intr_frame *);
 static void page_fault(struct intr_frame *);
 
@@ -63,8 +88,40 @@ void exception_init(void)
 void exception_print_stats(void)
 {
     printf("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+    for (int type = 0; type < FAULT_TYPE_CNT; type++)
+    {
+        if (fault_cnt[type] == 0)
+            continue;
+
+        printf("  %-9s %lld, %lld cycles avg, histogram",
+               fault_names[type], fault_cnt[type],
+               fault_cycles[type] / fault_cnt[type]);
+        for (int i = 0; i < FAULT_BUCKET_CNT; i++)
+            printf(" %lld", fault_hist[type][i]);
+        printf("\n");
+    }
+#endif
 }
 
+#ifdef VM
+/* Counts a page fault of the given TYPE that took CYCLES. */
+static void record_fault(enum fault_type type, uint64_t cycles)
+{
+    enum intr_level old_level;
+    int bucket = 0;
+
+    while (bucket < FAULT_BUCKET_CNT - 1 && cycles >= (1024ull << (2 * bucket)))
+        bucket++;
+
+    old_level = intr_disable();
+    fault_cnt[type]++;
+    fault_cycles[type] += cycles;
+    fault_hist[type][bucket]++;
+    intr_set_level(old_level);
+}
+#endif
+
 /* Handler for an exception (probably) caused by a user process. */
 static void kill(struct intr_frame *f)
 {
@@ -82,11 +139,12 @@ static void kill(struct intr_frame *f)
     {
     case SEL_UCSEG:
         /* User's code segment, so it's a user exception, as we
-           expected.  Kill the user process.  */
+           expected.  Kill the user process, with all of its
+           threads.  */
         printf("%s: dying due to interrupt %#04x (%s).\n",
                thread_name(), f->vec_no, intr_name(f->vec_no));
         intr_dump_frame(f);
-        thread_exit();
+        process_terminate(-1);
 
     case SEL_KCSEG:
         /* Kernel's code segment, which indicates a kernel bug.
@@ -145,6 +203,38 @@ static void page_fault(struct intr_frame *f)
     write = (f->error_code & PF_W) != 0;
     user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+    /* Faults from the kernel leave the user's esp saved by
+       syscall_handler() in place for stack growth checks. */
+    if (user)
+    {
+        thread_current()->user_esp = f->esp;
+        wset_admit();
+    }
+
+    /* Bring in the page if it belongs to the process's address
+       space, growing the stack if needed.  This also covers the
+       kernel touching user memory on behalf of a system call.
+       A write to a present page is the first write to a page
+       still mapped to the shared zero page. */
+    if (not_present || write)
+    {
+        uint64_t start = cpu_rdtsc();
+        enum fault_type type = page_in(fault_addr, write);
+
+        record_fault(type, cpu_rdtsc() - start);
+        if (type != FAULT_INVALID)
+            return;
+    }
+    else
+        record_fault(FAULT_INVALID, 0);
+#endif
+
+    /* The kernel may fault on user memory passed to a system call.
+       Make the access fail instead of panicking. */
+    if (!user && uaccess_fixup(f))
+        return;
+
     /* To implement virtual memory, delete the rest of the function
        body, and replace it with code that brings in the page to
        which fault_addr refers. */
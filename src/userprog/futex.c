@@ -0,0 +1,107 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <list.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+#include "userprog/uaccess.h"
+
+/* A thread blocked in futex_sleep(). */
+struct futex_waiter
+{
+    struct process *process; /* Address space of UADDR. */
+    const int *uaddr;        /* User address waited on. */
+    struct semaphore sema;   /* Upped to wake the thread. */
+    struct list_elem elem;   /* Element in `waiters'. */
+};
+
+/* Every waiting thread, in the order they started waiting.
+   There are few enough user threads that one list will do. */
+static struct list waiters;
+
+/* Protects `waiters'.  Held while futex_sleep() compares the user's
+   value, so that a wake cannot slip in between the comparison and
+   going to sleep. */
+static struct lock futex_lock;
+
+/* Initializes the futex wait list. */
+void futex_init(void)
+{
+    list_init(&waiters);
+    lock_init(&futex_lock);
+}
+
+/* If the int at user address UADDR still holds VAL, sleeps until
+   futex_wakeup() is called on UADDR by a thread of the same
+   process, or until the process exits.  Returns true if the
+   thread slept, false if the value had already changed or UADDR
+   could not be read. */
+bool futex_sleep(const int *uaddr, int val)
+{
+    struct process *self = thread_current()->process;
+    struct futex_waiter w;
+    int cur;
+
+    /* A process that is exiting has already had its waiters
+       woken by futex_wakeup_all(), so it must not add more. */
+    lock_acquire(&futex_lock);
+    if (self->exiting || !copy_from_user(&cur, uaddr, sizeof cur) || cur != val)
+    {
+        lock_release(&futex_lock);
+        return false;
+    }
+
+    w.process = self;
+    w.uaddr = uaddr;
+    sema_init(&w.sema, 0);
+    list_push_back(&waiters, &w.elem);
+    lock_release(&futex_lock);
+
+    sema_down(&w.sema);
+    return true;
+}
+
+/* Wakes up to CNT threads of the current process that wait on
+   UADDR, oldest first.  Returns the number woken. */
+int futex_wakeup(const int *uaddr, int cnt)
+{
+    struct process *self = thread_current()->process;
+    int woken = 0;
+
+    lock_acquire(&futex_lock);
+    for (struct list_elem *e = list_begin(&waiters);
+         e != list_end(&waiters) && woken < cnt;)
+    {
+        struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+
+        e = list_next(e);
+        if (w->process == self && w->uaddr == uaddr)
+        {
+            list_remove(&w->elem);
+            sema_up(&w->sema);
+            woken++;
+        }
+    }
+    lock_release(&futex_lock);
+
+    return woken;
+}
+
+/* Wakes every thread of process P that waits on any address, so
+   that it can notice that P is exiting. */
+void futex_wakeup_all(struct process *p)
+{
+    lock_acquire(&futex_lock);
+    for (struct list_elem *e = list_begin(&waiters); e != list_end(&waiters);)
+    {
+        struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+
+        e = list_next(e);
+        if (w->process == p)
+        {
+            list_remove(&w->elem);
+            sema_up(&w->sema);
+        }
+    }
+    lock_release(&futex_lock);
+}
@@ -0,0 +1,13 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdbool.h>
+
+struct process;
+
+void futex_init(void);
+bool futex_sleep(const int *uaddr, int val);
+int futex_wakeup(const int *uaddr, int cnt);
+void futex_wakeup_all(struct process *);
+
+#endif /* userprog/futex.h */
@@ -7,6 +7,7 @@
 #include "threads/palloc.h"
 
 static uint32_t *active_pd(void);
+static void load_pagedir(uint32_t *);
 static void invalidate_pagedir(uint32_t *);
 
 /* Creates a new page directory that has mappings for kernel
@@ -204,13 +205,24 @@ void pagedir_set_accessed(uint32_t *pd, const void *vpage, bool accessed)
     }
 }
 
-/* Loads page directory PD into the CPU's page directory base
-   register. */
+/* Makes page directory PD, or the base page directory if PD is
+   null, the CPU's active page directory.
+   Does nothing if PD is already active, as when switching
+   between kernel threads or threads of one process, since
+   reloading CR3 would needlessly flush the TLB. */
 void pagedir_activate(uint32_t *pd)
 {
     if (pd == NULL)
         pd = init_page_dir;
 
+    if (active_pd() != pd)
+        load_pagedir(pd);
+}
+
+/* Loads page directory PD into the CPU's page directory base
+   register, which flushes all non-global entries from the TLB. */
+static void load_pagedir(uint32_t *pd)
+{
     /* Store the physical address of the page directory into CR3
        aka PDBR (page directory base register).  This activates our
        new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -249,8 +261,9 @@ static void invalidate_pagedir(uint32_t *pd)
 {
     if (active_pd() == pd)
     {
-        /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-           "Translation Lookaside Buffers (TLBs)". */
-        pagedir_activate(pd);
+        /* Reloading PD clears the TLB of user mappings, which are
+           never global.  See [IA32-v3a] 3.12 "Translation
+           Lookaside Buffers (TLBs)". */
+        load_pagedir(pd);
     }
 }
@@ -5,37 +5,80 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "devices/input.h"
+#ifdef VM
+#include "devices/timer.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
+#include "vm/shm.h"
+#include "vm/wset.h"
+#endif
+
+/* Initial number of slots in a process's file descriptor table. */
+#define FD_TABLE_MIN 16
+
+/* All processes that have not been freed, keyed by pid.
+   Protected by process_lock, as is process_num. */
+static struct hash process_table;
+static struct lock process_lock;
+
+/* Number of running processes, counting the initial thread. */
+static int process_num = 1;
 
-/* List of all user processes. */
-static struct list all_list;
+/* Maximum number of user processes. */
+int process_limit = PROCESS_LIMIT_DEFAULT;
 
-static int process_num = 1;
-enum
+/* Page directories of exited processes, waiting to be destroyed.
+   Destroying a page directory walks every user page table, so an
+   exiting process leaves it to the reaper thread instead of
+   making its parent's wait() take longer.  Protected by
+   reap_lock. */
+struct dead_pagedir
 {
-    PROCESS_NUM_LIMIT = 32
+    uint32_t *pd;          /* Page directory to destroy. */
+    struct list_elem elem; /* Element in `dead_pagedirs'. */
 };
+static struct list dead_pagedirs;
+static struct lock reap_lock;
+static struct semaphore reap_sema; /* Upped once per dead_pagedirs entry. */
+static bool reaper_started;        /* Reaper thread running? */
+
+/* Protects the ELF header cache, elf_cache[], defined with the ELF
+   types further down. */
+static struct lock elf_cache_lock;
+
+static hash_hash_func process_hash;
+static hash_less_func process_less;
 
 static thread_func start_process NO_RETURN;
+static thread_func reaper NO_RETURN;
+static void reap_pagedirs(void);
+static void destroy_later(uint32_t *pd);
 static bool load(const char *cmdline, void (**eip)(void), void **esp);
 static void process_load_fail(void);
-static void process_load_success(const char *cmd);
+static void process_load_success(void);
 
 typedef void (*ret_addr_t)(void);
 typedef union
 {
     void *vp;
+    void **vpp;
     char *cp;
     unsigned u;
     char **cpp;
@@ -43,12 +86,111 @@ typedef union
     int *ip;
     ret_addr_t *rap;
 } esp_t;
-static void *arg_pass(esp_t esp, char *cmd, char *save_ptr);
+/* A command line split into arguments, as handed to a new
+   process, with the process's initial file descriptors. */
+struct cmdline
+{
+    struct fd_table fds; /* Initial file descriptors. */
+    int argc;    /* Number of arguments. */
+    size_t size; /* Bytes in ARGS. */
+    char args[]; /* ARGC null-terminated strings, back to back. */
+};
+
+static struct cmdline *parse_cmdline(const char *cmd_line);
+static void *arg_pass(esp_t esp, const struct cmdline *);
+
+/* A thread of a user process other than its initial thread. */
+struct user_thread
+{
+    tid_t tid;             /* Thread identifier. */
+    int slot;              /* Stack slot, see thread_stack_top(). */
+    bool done;             /* Has the thread exited? */
+    bool joined;           /* Is a thread waiting to join it? */
+    struct list_elem elem; /* Element in process's `threads'. */
+};
+
+/* What a new user thread needs to start running. */
+struct thread_start
+{
+    struct process *process; /* Process to join. */
+    struct user_thread *ut;  /* Its entry in the process. */
+    void *eip;               /* User entry point. */
+    void *arg0, *arg1;       /* Passed on the user stack. */
+};
+
+static thread_func start_thread NO_RETURN;
+static void exit_user_thread(void);
+static void terminate_threads(struct process *);
 
 /* Initializes the user process system. */
 void process_init(void)
 {
-    list_init(&all_list);
+    hash_init(&process_table, process_hash, process_less, NULL);
+    lock_init(&process_lock);
+    futex_init();
+
+    list_init(&dead_pagedirs);
+    lock_init(&reap_lock);
+    sema_init(&reap_sema, 0);
+
+    lock_init(&elf_cache_lock);
+}
+
+/* Starts the thread that destroys the page directories of exited
+   processes.  Until it runs, they are destroyed on exit. */
+void process_reaper_start(void)
+{
+    reaper_started = thread_create("reaper", PRI_DEFAULT, reaper, NULL) != TID_ERROR;
+}
+
+/* Reaper thread.  Destroys page directories handed over by
+   destroy_later() as they come. */
+static void reaper(void *aux UNUSED)
+{
+    for (;;)
+    {
+        sema_down(&reap_sema);
+        reap_pagedirs();
+    }
+}
+
+/* Destroys every page directory waiting in dead_pagedirs. */
+static void reap_pagedirs(void)
+{
+    for (;;)
+    {
+        struct dead_pagedir *d = NULL;
+
+        lock_acquire(&reap_lock);
+        if (!list_empty(&dead_pagedirs))
+            d = list_entry(list_pop_front(&dead_pagedirs), struct dead_pagedir, elem);
+        lock_release(&reap_lock);
+
+        if (d == NULL)
+            break;
+        pagedir_destroy(d->pd);
+        free(d);
+    }
+}
+
+/* Hands page directory PD, which must not be active, to the reaper
+   thread to destroy.  Destroys it right away if the reaper is not
+   running or memory is short. */
+static void destroy_later(uint32_t *pd)
+{
+    struct dead_pagedir *d = reaper_started ? malloc(sizeof *d) : NULL;
+
+    if (d == NULL)
+    {
+        pagedir_destroy(pd);
+        return;
+    }
+
+    d->pd = pd;
+    lock_acquire(&reap_lock);
+    list_push_back(&dead_pagedirs, &d->elem);
+    lock_release(&reap_lock);
+    sema_up(&reap_sema);
 }
 
 /* Starts a new thread running a user program loaded from
@@ -57,56 +199,123 @@ void process_init(void)
    thread id, or TID_ERROR if the thread cannot be created. */
 tid_t process_execute(const char *file_name)
 {
-    if (process_num == PROCESS_NUM_LIMIT)
-        return TID_ERROR;
-    ++process_num;
+    return process_spawn(file_name, NULL);
+}
 
-    char *fn_copy0, *fn_copy1;
-    tid_t tid;
+/* Like process_execute(), but the new process starts out with the
+   file descriptors in FDS, if FDS is nonnull, instead of none.
+   Takes ownership of FDS's files, which are closed if the process
+   cannot be created, and leaves FDS empty. */
+tid_t process_spawn(const char *cmd_line, struct fd_table *fds)
+{
+    struct cmdline *cmdline = NULL;
+    tid_t tid = TID_ERROR;
 
-    /* Make a copy of FILE_NAME.
-       Otherwise strtok_r will modify the const char *file_name. */
-    fn_copy0 = palloc_get_page(0);
-    if (fn_copy0 == NULL)
-        return TID_ERROR;
+    lock_acquire(&process_lock);
+    bool full = process_num >= process_limit;
+    if (!full)
+        ++process_num;
+    lock_release(&process_lock);
 
-    /* Make a copy of FILE_NAME.
-       Otherwise there's a race between the caller and load(). */
-    fn_copy1 = palloc_get_page(0);
-    if (fn_copy1 == NULL)
+    if (!full)
     {
-        palloc_free_page(fn_copy0);
-        return TID_ERROR;
-    }
+        /* Split CMD_LINE into arguments now, so that there's no
+           race between the caller and load(). */
+        cmdline = parse_cmdline(cmd_line);
+        if (cmdline != NULL && fds != NULL)
+        {
+            cmdline->fds = *fds;
+            fd_table_init(fds);
+        }
 
-    strlcpy(fn_copy0, file_name, PGSIZE);
-    strlcpy(fn_copy1, file_name, PGSIZE);
+        /* Create a new thread to execute the program named by the
+           first argument. */
+        if (cmdline != NULL)
+            tid = thread_create(cmdline->args, PRI_DEFAULT, start_process, cmdline);
+    }
 
-    /* Create a new thread to execute FILE_NAME. */
-    char *save_ptr;
-    char *cmd = strtok_r(fn_copy0, " ", &save_ptr);
-    tid = thread_create(cmd, PRI_DEFAULT, start_process, fn_copy1);
     if (tid == TID_ERROR)
-        palloc_free_page(fn_copy1);
-
-    palloc_free_page(fn_copy0);
+    {
+        if (cmdline != NULL)
+        {
+            fd_table_destroy(&cmdline->fds);
+            free(cmdline);
+        }
+        if (fds != NULL)
+            fd_table_destroy(fds);
+        if (!full)
+        {
+            lock_acquire(&process_lock);
+            --process_num;
+            lock_release(&process_lock);
+        }
+        return TID_ERROR;
+    }
 
-    if (thread_current()->tid != 1 && tid != TID_ERROR)
+    if (thread_current()->tid != 1)
     {
         struct process *self = thread_current()->process;
         struct process *child = get_process(tid);
+        lock_acquire(&process_lock);
         child->parent = self;
         list_push_back(&self->children, &child->elem);
+        lock_release(&process_lock);
     }
 
     return tid;
 }
 
+/* Splits CMD_LINE into space-separated arguments.  Returns them in
+   a new struct cmdline, which the caller must free, or a null
+   pointer if there are no arguments, if they would not fit in the
+   initial stack page, or if memory cannot be allocated. */
+static struct cmdline *parse_cmdline(const char *cmd_line)
+{
+    struct cmdline *cmdline;
+    const char *p;
+    size_t size = 0;
+    int argc = 0;
+
+    /* Measure. */
+    for (p = cmd_line; *p != '\0'; p++)
+        if (*p != ' ')
+        {
+            if (p == cmd_line || p[-1] == ' ')
+                argc++;
+            size++;
+        }
+    size += argc;
+
+    /* Leave room for argv[], argv, argc, and the return address. */
+    if (argc == 0 || ROUND_UP(size, sizeof(char *)) + (argc + 4) * sizeof(char *) > PGSIZE)
+        return NULL;
+
+    cmdline = malloc(sizeof *cmdline + size);
+    if (cmdline == NULL)
+        return NULL;
+    fd_table_init(&cmdline->fds);
+    cmdline->argc = argc;
+    cmdline->size = size;
+
+    /* Copy, ending each argument with a null terminator. */
+    char *q = cmdline->args;
+    for (p = cmd_line; *p != '\0'; p++)
+        if (*p != ' ')
+        {
+            *q++ = *p;
+            if (p[1] == ' ' || p[1] == '\0')
+                *q++ = '\0';
+        }
+    ASSERT(q == cmdline->args + size);
+
+    return cmdline;
+}
+
 /* A thread function that loads a user process and starts it
    running. */
-static void start_process(void *file_name_)
+static void start_process(void *cmdline_)
 {
-    char *file_name = file_name_;
+    struct cmdline *cmdline = cmdline_;
     struct intr_frame if_;
     bool success;
 
@@ -116,19 +325,20 @@ static void start_process(void *file_name_)
     if_.cs = SEL_UCSEG;
     if_.eflags = FLAG_IF | FLAG_MBS;
 
+    /* Take over the file descriptors handed down by the parent. */
+    thread_current()->process->fds = cmdline->fds;
+
     /* Load executable. */
-    char *save_ptr;
-    char *cmd = strtok_r(file_name, " ", &save_ptr);
-    success = load(cmd, &if_.eip, &if_.esp);
+    success = load(cmdline->args, &if_.eip, &if_.esp);
 
     if (success)
     {
-        if_.esp = arg_pass((esp_t)if_.esp, cmd, save_ptr);
-        process_load_success(cmd);
+        if_.esp = arg_pass((esp_t)if_.esp, cmdline);
+        process_load_success();
     }
 
-    /* Free file_name whether successed or failed. */
-    palloc_free_page(file_name);
+    /* Free cmdline whether successed or failed. */
+    free(cmdline);
 
     if (!success)
     {
@@ -152,34 +362,31 @@ static void start_process(void *file_name_)
 }
 
 /* Argument passing. */
-static void *arg_pass(esp_t esp, char *cmd, char *save_ptr)
+static void *arg_pass(esp_t esp, const struct cmdline *cmdline)
 {
-    /* Push arguments. */
-    char *arg_ptrs[1024];
-    size_t i = 0;
-    for (char *arg = cmd; arg != NULL; arg = strtok_r(NULL, " ", &save_ptr))
-    {
-        size_t size = strlen(arg) + 1;
-        esp.cp -= size;
-        strlcpy(esp.cp, arg, size);
-        arg_ptrs[i++] = esp.cp;
-    }
-    int argc = i;
-    arg_ptrs[i++] = NULL;
+    /* Push all the argument strings at once. */
+    esp.cp -= cmdline->size;
+    memcpy(esp.cp, cmdline->args, cmdline->size);
+    char *arg = esp.cp;
 
     /* Push word-align. */
     esp.u -= esp.u % 4;
 
-    /* Push argv[i]. */
-    esp.cpp -= i;
-    memcpy(esp.cpp, arg_ptrs, i * sizeof(char *));
+    /* Push argv[i], followed by a null pointer. */
+    esp.cpp -= cmdline->argc + 1;
     char **argv = esp.cpp;
+    for (int i = 0; i < cmdline->argc; i++)
+    {
+        argv[i] = arg;
+        arg += strlen(arg) + 1;
+    }
+    argv[cmdline->argc] = NULL;
 
     /* Push argv. */
     *(--esp.cppp) = argv;
 
     /* Push argc. */
-    *(--esp.ip) = argc;
+    *(--esp.ip) = cmdline->argc;
 
     /* Push fake return address. */
     *(--esp.rap) = NULL;
@@ -203,23 +410,48 @@ int process_wait(tid_t child_tid)
 
     sema_down(&child->sema_wait);
 
-    if (!cur_init)
-        list_remove(&child->elem);
-    list_remove(&child->allelem);
     int exit_code = child->exit_code;
-    palloc_free_page(child);
+    process_free(child);
 
     return exit_code;
 }
 
-/* Free the current process's resources. */
+/* Free the current process's resources.  A thread other than the
+   process's initial thread releases only its own. */
 void process_exit(void)
 {
-    --process_num;
-
     struct thread *cur = thread_current();
+    struct process *self = cur->process;
     uint32_t *pd;
 
+    if (cur != self->thread)
+    {
+        exit_user_thread();
+        return;
+    }
+
+    /* The other threads share our address space, so they must be
+       gone before it is torn down.  Unless the process is being
+       terminated, they are left to finish on their own. */
+    lock_acquire(&self->thread_lock);
+    while (self->thread_cnt > 0)
+        cond_wait(&self->thread_exited, &self->thread_lock);
+    while (!list_empty(&self->threads))
+        free(list_entry(list_pop_front(&self->threads), struct user_thread, elem));
+    lock_release(&self->thread_lock);
+
+    /* Children we did not wait for become orphans, which nobody
+       waits for, so that none of them points to us once we have
+       been freed. */
+    lock_acquire(&process_lock);
+    --process_num;
+    while (!list_empty(&self->children))
+    {
+        struct list_elem *e = list_pop_front(&self->children);
+        list_entry(e, struct process, elem)->parent = NULL;
+    }
+    lock_release(&process_lock);
+
     /* Destroy the current process's page directory and switch back
        to the kernel-only page directory. */
     pd = cur->pagedir;
@@ -227,22 +459,39 @@ void process_exit(void)
     {
         printf("%s: exit(%d)\n", cur->name, cur->process->exit_code);
 
+#ifdef VM
+        /* Write back mapped files and release every frame and swap
+           slot while the page directory can still tell us which
+           pages are dirty. */
+        mmap_exit();
+        shm_exit();
+        page_table_destroy(cur);
+        wset_exit(cur->process);
+#endif
+
         /* Correct ordering here is crucial.  We must set
            cur->pagedir to NULL before switching page directories,
            so that a timer interrupt can't switch back to the
            process page directory.  We must activate the base page
            directory before destroying the process's page
            directory, or our active page directory will be one
-           that's been freed (and cleared). */
+           that's been freed (and cleared).  The reaper destroys
+           it after our parent has been woken up. */
         cur->pagedir = NULL;
         pagedir_activate(NULL);
-        pagedir_destroy(pd);
+        destroy_later(pd);
     }
 
-    struct process *self = cur->process;
-
     self->thread = NULL;
-    self->status = PROCESS_EXITED;
+
+    /* A process that failed to load stays PROCESS_FAILED, because
+       exec() may not have looked at its status yet. */
+    if (self->status != PROCESS_FAILED)
+        self->status = PROCESS_EXITED;
+
+    /* Close all open files, including those of a process that was
+       killed rather than calling exit(). */
+    fd_table_destroy(&self->fds);
 
     if (self->file != NULL)
     {
@@ -253,6 +502,64 @@ void process_exit(void)
     sema_up(&self->sema_wait);
 }
 
+/* Terminates every thread of the current process, which exits
+   with STATUS unless it is already being terminated.  Threads
+   blocked in the kernel leave once they are about to return to
+   user mode. */
+void process_terminate(int status)
+{
+    struct process *self = thread_current()->process;
+
+    lock_acquire(&self->thread_lock);
+    if (!self->exiting)
+    {
+        self->exit_code = status;
+        self->exiting = true;
+    }
+    lock_release(&self->thread_lock);
+
+    terminate_threads(self);
+    thread_exit();
+}
+
+/* Marks process P as exiting and wakes its threads that are
+   waiting in join, on a futex, on a pipe, or for console input,
+   so that they can leave. */
+static void terminate_threads(struct process *p)
+{
+    lock_acquire(&p->thread_lock);
+    p->exiting = true;
+    cond_broadcast(&p->thread_exited, &p->thread_lock);
+    lock_release(&p->thread_lock);
+
+    futex_wakeup_all(p);
+    pipe_wakeup_all();
+    input_wakeup_all();
+}
+
+/* Returns true if the current process is being terminated.  Its
+   threads should then give up blocking waits, so that they reach
+   process_return_to_user() and exit. */
+bool process_exiting(void)
+{
+    struct process *self = thread_current()->process;
+
+    return self != NULL && self->exiting;
+}
+
+/* Called on every return to user mode.  Exits the current thread
+   if its process is being terminated. */
+void process_return_to_user(void)
+{
+    struct process *self = thread_current()->process;
+
+    if (self != NULL && self->exiting)
+    {
+        intr_enable();
+        thread_exit();
+    }
+}
+
 /* Sets up the CPU for running user code in the current
    thread.
    This function is called on every context switch. */
@@ -331,6 +638,38 @@ struct Elf32_Phdr
 #define PF_W 2 /* Writable. */
 #define PF_R 4 /* Readable. */
 
+/* An executable's headers, as much of them as load() needs once
+   they have been validated. */
+struct elf_image
+{
+    Elf32_Addr entry;         /* Entry point. */
+    int load_cnt;             /* Number of PT_LOAD segments. */
+    struct Elf32_Phdr *loads; /* PT_LOAD program headers, in order. */
+};
+
+/* Number of executables whose headers are cached. */
+#define ELF_CACHE_SIZE 8
+
+/* Cache of the headers of recently loaded executables, so that
+   executing the same program again skips reading and validating
+   them.  An entry keeps its executable's inode open, which keeps
+   the inode's write count meaningful: an entry is used only while
+   the count is what it was when the entry was filled in.
+   Protected by elf_cache_lock. */
+static struct elf_cache_entry
+{
+    struct inode *inode;      /* Executable, or null if unused. */
+    unsigned write_cnt;       /* inode_write_cnt(INODE) when cached. */
+    unsigned last_use;        /* elf_cache_clock at last use. */
+    struct elf_image image;   /* Cached headers. */
+} elf_cache[ELF_CACHE_SIZE];
+static unsigned elf_cache_clock;
+
+static bool read_elf(const char *file_name, struct file *,
+                     struct elf_image *);
+static bool elf_cache_get(struct inode *, struct elf_image *);
+static void elf_cache_drop(bool all);
+static void elf_cache_put(struct inode *, const struct elf_image *);
 static bool setup_stack(void **esp);
 static bool validate_segment(const struct Elf32_Phdr *, struct file *);
 static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
@@ -344,16 +683,24 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
 bool load(const char *file_name, void (**eip)(void), void **esp)
 {
     struct thread *t = thread_current();
-    struct Elf32_Ehdr ehdr;
+    struct elf_image image = {0, 0, NULL};
     struct file *file = NULL;
-    off_t file_ofs;
     bool success = false;
     int i;
 
+    /* Take back the memory of processes that have exited but whose
+       page directories the reaper has not got to yet, so that a
+       process never fails to load for want of it. */
+    reap_pagedirs();
+
     /* Allocate and activate page directory. */
     t->pagedir = pagedir_create();
     if (t->pagedir == NULL)
         goto done;
+#ifdef VM
+    if (!page_table_create(t))
+        goto done;
+#endif
     process_activate();
 
     /* Open executable file. */
@@ -364,27 +711,104 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
         goto done;
     }
 
+    /* Keep the executable open and unmodifiable while we run.
+       process_exit() closes it. */
+    file_deny_write(file);
+    t->process->file = file;
+
+    /* Read and verify the headers, unless they are cached. */
+    if (!elf_cache_get(file_get_inode(file), &image))
+    {
+        if (!read_elf(file_name, file, &image))
+            goto done;
+        elf_cache_put(file_get_inode(file), &image);
+    }
+
+    /* Load segments. */
+    for (i = 0; i < image.load_cnt; i++)
+    {
+        const struct Elf32_Phdr *phdr = &image.loads[i];
+        bool writable = (phdr->p_flags & PF_W) != 0;
+        uint32_t file_page = phdr->p_offset & ~PGMASK;
+        uint32_t mem_page = phdr->p_vaddr & ~PGMASK;
+        uint32_t page_offset = phdr->p_vaddr & PGMASK;
+        uint32_t read_bytes, zero_bytes;
+        if (phdr->p_filesz > 0)
+        {
+            /* Normal segment.
+               Read initial part from disk and zero the rest. */
+            read_bytes = page_offset + phdr->p_filesz;
+            zero_bytes = (ROUND_UP(page_offset + phdr->p_memsz, PGSIZE) - read_bytes);
+        }
+        else
+        {
+            /* Entirely zero.
+               Don't read anything from disk. */
+            read_bytes = 0;
+            zero_bytes = ROUND_UP(page_offset + phdr->p_memsz, PGSIZE);
+        }
+        if (!load_segment(file, file_page, (void *)mem_page,
+                          read_bytes, zero_bytes, writable))
+            goto done;
+    }
+
+    /* Set up stack. */
+    if (!setup_stack(esp))
+        goto done;
+
+    /* Start address. */
+    *eip = (void (*)(void))image.entry;
+
+    success = true;
+
+done:
+    /* We arrive here whether the load is successful or not. */
+    free(image.loads);
+    return success;
+}
+
+/* load() helpers. */
+
+/* Reads the headers of executable FILE, named FILE_NAME, into
+   *IMAGE and checks that FILE can be loaded.  The whole program
+   header table is read at once.  On success, IMAGE->loads is
+   allocated with malloc() and owned by the caller.  Returns true
+   if successful, false otherwise. */
+static bool read_elf(const char *file_name, struct file *file,
+                     struct elf_image *image)
+{
+    struct Elf32_Ehdr ehdr;
+    struct Elf32_Phdr *phdrs = NULL;
+    off_t phdrs_size;
+    int i;
+
     /* Read and verify executable header. */
-    if (file_read(file, &ehdr, sizeof ehdr) != sizeof ehdr || memcmp(ehdr.e_ident, "\177ELF\1\1\1", 7) || ehdr.e_type != 2 || ehdr.e_machine != 3 || ehdr.e_version != 1 || ehdr.e_phentsize != sizeof(struct Elf32_Phdr) || ehdr.e_phnum > 1024)
+    if (file_read_at(file, &ehdr, sizeof ehdr, 0) != sizeof ehdr || memcmp(ehdr.e_ident, "\177ELF\1\1\1", 7) || ehdr.e_type != 2 || ehdr.e_machine != 3 || ehdr.e_version != 1 || ehdr.e_phentsize != sizeof(struct Elf32_Phdr) || ehdr.e_phnum > 1024)
     {
         printf("load: %s: error loading executable\n", file_name);
-        goto done;
+        return false;
     }
 
     /* Read program headers. */
-    file_ofs = ehdr.e_phoff;
-    for (i = 0; i < ehdr.e_phnum; i++)
+    phdrs_size = ehdr.e_phnum * sizeof *phdrs;
+    if (phdrs_size > 0)
     {
-        struct Elf32_Phdr phdr;
-
-        if (file_ofs < 0 || file_ofs > file_length(file))
-            goto done;
-        file_seek(file, file_ofs);
+        if (ehdr.e_phoff > (Elf32_Off)file_length(file))
+            return false;
+        phdrs = malloc(phdrs_size);
+        if (phdrs == NULL)
+            return false;
+        if (file_read_at(file, phdrs, phdrs_size, ehdr.e_phoff) != phdrs_size)
+            goto fail;
+    }
 
-        if (file_read(file, &phdr, sizeof phdr) != sizeof phdr)
-            goto done;
-        file_ofs += sizeof phdr;
-        switch (phdr.p_type)
+    /* Keep the PT_LOAD headers, packed at the start of PHDRS. */
+    image->entry = ehdr.e_entry;
+    image->load_cnt = 0;
+    image->loads = phdrs;
+    for (i = 0; i < ehdr.e_phnum; i++)
+    {
+        switch (phdrs[i].p_type)
         {
         case PT_NULL:
         case PT_NOTE:
@@ -396,57 +820,146 @@ bool load(const char *file_name, void (**eip)(void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-            goto done;
+            goto fail;
         case PT_LOAD:
-            if (validate_segment(&phdr, file))
-            {
-                bool writable = (phdr.p_flags & PF_W) != 0;
-                uint32_t file_page = phdr.p_offset & ~PGMASK;
-                uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
-                uint32_t page_offset = phdr.p_vaddr & PGMASK;
-                uint32_t read_bytes, zero_bytes;
-                if (phdr.p_filesz > 0)
-                {
-                    /* Normal segment.
-                       Read initial part from disk and zero the rest. */
-                    read_bytes = page_offset + phdr.p_filesz;
-                    zero_bytes = (ROUND_UP(page_offset + phdr.p_memsz, PGSIZE) - read_bytes);
-                }
-                else
-                {
-                    /* Entirely zero.
-                       Don't read anything from disk. */
-                    read_bytes = 0;
-                    zero_bytes = ROUND_UP(page_offset + phdr.p_memsz, PGSIZE);
-                }
-                if (!load_segment(file, file_page, (void *)mem_page,
-                                  read_bytes, zero_bytes, writable))
-                    goto done;
-            }
-            else
-                goto done;
+            if (!validate_segment(&phdrs[i], file))
+                goto fail;
+            phdrs[image->load_cnt++] = phdrs[i];
             break;
         }
     }
+    return true;
 
-    /* Set up stack. */
-    if (!setup_stack(esp))
-        goto done;
+fail:
+    free(phdrs);
+    image->loads = NULL;
+    return false;
+}
 
-    /* Start address. */
-    *eip = (void (*)(void))ehdr.e_entry;
+/* Copies the cached headers of executable INODE into *IMAGE, with
+   IMAGE->loads allocated with malloc() and owned by the caller.
+   Returns false if they are not cached or have been invalidated by
+   a write. */
+static bool elf_cache_get(struct inode *inode, struct elf_image *image)
+{
+    bool found = false;
 
-    success = true;
+    lock_acquire(&elf_cache_lock);
+    elf_cache_drop(false);
+    for (int i = 0; i < ELF_CACHE_SIZE; i++)
+    {
+        struct elf_cache_entry *e = &elf_cache[i];
 
-done:
-    /* We arrive here whether the load is successful or not. */
-    file_close(file);
-    return success;
+        if (e->inode == inode)
+        {
+            size_t size = e->image.load_cnt * sizeof *e->image.loads;
+
+            *image = e->image;
+            image->loads = size > 0 ? malloc(size) : NULL;
+            if (size > 0 && image->loads == NULL)
+                break;
+            memcpy(image->loads, e->image.loads, size);
+            e->last_use = ++elf_cache_clock;
+            found = true;
+            break;
+        }
+    }
+    lock_release(&elf_cache_lock);
+
+    return found;
 }
 
-/* load() helpers. */
+/* Drops every entry of the ELF header cache if ALL is true, or
+   otherwise the entries invalidated by a write and those of
+   executables that have been removed, since nothing can open those
+   again.  Closing a removed executable's last reference frees its
+   blocks.  elf_cache_lock must be held. */
+static void elf_cache_drop(bool all)
+{
+    ASSERT(lock_held_by_current_thread(&elf_cache_lock));
+
+    for (int i = 0; i < ELF_CACHE_SIZE; i++)
+    {
+        struct elf_cache_entry *e = &elf_cache[i];
+
+        if (e->inode != NULL && (all || inode_is_removed(e->inode) || inode_write_cnt(e->inode) != e->write_cnt))
+        {
+            inode_close(e->inode);
+            free(e->image.loads);
+            e->inode = NULL;
+        }
+    }
+}
+
+/* Lets go of cached executables that have been removed, so that
+   their blocks are freed once no process runs them. */
+void process_file_removed(void)
+{
+    lock_acquire(&elf_cache_lock);
+    elf_cache_drop(false);
+    lock_release(&elf_cache_lock);
+}
+
+/* Shuts down the user process system.  Closes the executables
+   that the ELF header cache keeps open, which must happen before
+   the file system is shut down. */
+void process_done(void)
+{
+    lock_acquire(&elf_cache_lock);
+    elf_cache_drop(true);
+    lock_release(&elf_cache_lock);
+}
+
+/* Caches a copy of IMAGE, the headers of executable INODE,
+   replacing the least recently used entry if the cache is full.
+   INODE must be denied writes, so that IMAGE is current. */
+static void elf_cache_put(struct inode *inode, const struct elf_image *image)
+{
+    size_t size = image->load_cnt * sizeof *image->loads;
+    struct elf_cache_entry *victim = NULL;
+    struct Elf32_Phdr *loads = NULL;
+
+    if (size > 0)
+    {
+        loads = malloc(size);
+        if (loads == NULL)
+            return;
+        memcpy(loads, image->loads, size);
+    }
 
+    lock_acquire(&elf_cache_lock);
+    for (int i = 0; i < ELF_CACHE_SIZE; i++)
+    {
+        struct elf_cache_entry *e = &elf_cache[i];
+        if (e->inode == inode)
+        {
+            /* Another process cached it first. */
+            lock_release(&elf_cache_lock);
+            free(loads);
+            return;
+        }
+        if (e->inode == NULL)
+            victim = e;
+        else if (victim == NULL || (victim->inode != NULL && e->last_use < victim->last_use))
+            victim = e;
+    }
+
+    if (victim->inode != NULL)
+    {
+        inode_close(victim->inode);
+        free(victim->image.loads);
+    }
+    victim->inode = inode_reopen(inode);
+    victim->write_cnt = inode_write_cnt(inode);
+    victim->last_use = ++elf_cache_clock;
+    victim->image = *image;
+    victim->image.loads = loads;
+    lock_release(&elf_cache_lock);
+}
+
+#ifndef VM
 static bool install_page(void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -513,6 +1026,32 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
     ASSERT(pg_ofs(upage) == 0);
     ASSERT(ofs % PGSIZE == 0);
 
+#ifdef VM
+    /* Only record where each page comes from.
+       The page fault handler reads it in on first access. */
+    while (read_bytes > 0 || zero_bytes > 0)
+    {
+        size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+        size_t page_zero_bytes = PGSIZE - page_read_bytes;
+
+        struct page *p = page_allocate(upage, writable);
+        if (p == NULL)
+            return false;
+        if (page_read_bytes > 0)
+        {
+            p->file = file;
+            p->file_ofs = ofs;
+            p->file_bytes = page_read_bytes;
+        }
+
+        /* Advance. */
+        read_bytes -= page_read_bytes;
+        zero_bytes -= page_zero_bytes;
+        ofs += page_read_bytes;
+        upage += PGSIZE;
+    }
+    return true;
+#else
     file_seek(file, ofs);
     while (read_bytes > 0 || zero_bytes > 0)
     {
@@ -548,12 +1087,20 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
         upage += PGSIZE;
     }
     return true;
+#endif
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
    user virtual memory. */
 static bool setup_stack(void **esp)
 {
+#ifdef VM
+    /* The page is zero-filled when argument passing first touches it. */
+    if (page_allocate(((uint8_t *)PHYS_BASE) - PGSIZE, true) == NULL)
+        return false;
+    *esp = PHYS_BASE;
+    return true;
+#else
     uint8_t *kpage;
     bool success = false;
 
@@ -567,8 +1114,10 @@ static bool setup_stack(void **esp)
             palloc_free_page(kpage);
     }
     return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -586,12 +1135,13 @@ static bool install_page(void *upage, void *kpage, bool writable)
        address, then map our page there. */
     return (pagedir_get_page(t->pagedir, upage) == NULL && pagedir_set_page(t->pagedir, upage, kpage, writable));
 }
+#endif
 
 /* Creates a struct process that correspond to T. */
 struct process *process_create(struct thread *t)
 {
     /* Allocate process. */
-    struct process *p = palloc_get_page(PAL_ZERO);
+    struct process *p = calloc(1, sizeof *p);
     if (p == NULL)
         return NULL;
 
@@ -600,54 +1150,565 @@ struct process *process_create(struct thread *t)
     p->status = PROCESS_LOADING;
     p->exit_code = -1;
 
-    list_push_back(&all_list, &p->allelem);
+    lock_acquire(&process_lock);
+    hash_insert(&process_table, &p->hash_elem);
+    lock_release(&process_lock);
     list_init(&p->children);
     p->parent = NULL;
 
     sema_init(&p->sema_load, 0);
     sema_init(&p->sema_wait, 0);
 
-    list_init(&p->files);
-    p->fd = 2;
+    fd_table_init(&p->fds);
+    lock_init(&p->fds_lock);
+
+    lock_init(&p->thread_lock);
+    cond_init(&p->thread_exited);
+    list_init(&p->threads);
+    p->thread_cnt = 0;
+    p->stack_slots = 0;
+    p->exiting = false;
+
+#ifdef VM
+    lock_init(&p->mm_lock);
+    list_init(&p->mappings);
+    p->mapid = 0;
+    list_init(&p->shm_attachments);
+    p->start_time = timer_ticks();
+#endif
 
     return p;
 }
 
-/* Get struct process in ALL_LIST by pid. */
+/* Frees process P, which must have exited, removing it from the
+   process table and from its parent's children. */
+void process_free(struct process *p)
+{
+    ASSERT(p->status == PROCESS_FAILED || p->status == PROCESS_EXITED);
+
+    lock_acquire(&process_lock);
+    hash_delete(&process_table, &p->hash_elem);
+
+    if (p->parent != NULL)
+        list_remove(&p->elem);
+    lock_release(&process_lock);
+    free(p);
+}
+
+/* Returns the process with the given PID. */
 struct process *get_process(pid_t pid)
 {
     ASSERT(pid != TID_ERROR);
 
-    struct list *l = &all_list;
+    struct process key;
+    struct hash_elem *e;
 
-    for (struct list_elem *e = list_begin(l); e != list_end(l); e = list_next(e))
-    {
-        struct process *p = list_entry(e, struct process, allelem);
-        if (p->pid == pid)
-            return p;
-    }
+    key.pid = pid;
+    lock_acquire(&process_lock);
+    e = hash_find(&process_table, &key.hash_elem);
+    lock_release(&process_lock);
 
-    NOT_REACHED();
+    ASSERT(e != NULL);
+    return hash_entry(e, struct process, hash_elem);
 }
 
-/* Get struct process in self's children by pid.
-    Returns NULL if not found. */
+/* Returns the current process's child with the given PID,
+    or a null pointer if there is none. */
 struct process *get_child(pid_t pid)
 {
     ASSERT(pid != TID_ERROR);
 
     struct list *l = &thread_current()->process->children;
+    struct process *child = NULL;
 
+    lock_acquire(&process_lock);
     for (struct list_elem *e = list_begin(l); e != list_end(l); e = list_next(e))
     {
         struct process *p = list_entry(e, struct process, elem);
         if (p->pid == pid)
-            return p;
+        {
+            child = p;
+            break;
+        }
+    }
+    lock_release(&process_lock);
+
+    return child;
+}
+
+/* Returns a hash value for process P. */
+static unsigned process_hash(const struct hash_elem *p_, void *aux UNUSED)
+{
+    const struct process *p = hash_entry(p_, struct process, hash_elem);
+    return hash_int(p->pid);
+}
+
+/* Returns true if process A precedes process B. */
+static bool process_less(const struct hash_elem *a_, const struct hash_elem *b_,
+                         void *aux UNUSED)
+{
+    const struct process *a = hash_entry(a_, struct process, hash_elem);
+    const struct process *b = hash_entry(b_, struct process, hash_elem);
+
+    return a->pid < b->pid;
+}
+
+/* Initializes T as an empty file descriptor table. */
+void fd_table_init(struct fd_table *t)
+{
+    t->files = NULL;
+    t->cnt = 0;
+    t->free = 2;
+}
+
+/* Initializes DST as a copy of SRC, with each file duplicated.
+   Returns false if memory allocation fails. */
+bool fd_table_copy(struct fd_table *dst, const struct fd_table *src)
+{
+    fd_table_init(dst);
+    if (src->cnt == 0)
+        return true;
+
+    dst->files = calloc(src->cnt, sizeof *dst->files);
+    if (dst->files == NULL)
+        return false;
+    dst->cnt = src->cnt;
+    dst->free = src->free;
+
+    for (int fd = 0; fd < src->cnt; fd++)
+        if (src->files[fd] != NULL)
+            dst->files[fd] = file_dup(src->files[fd]);
+    return true;
+}
+
+/* Closes every file in T and frees T's storage, leaving it
+   empty. */
+void fd_table_destroy(struct fd_table *t)
+{
+    for (int fd = 0; fd < t->cnt; fd++)
+        if (t->files[fd] != NULL)
+            file_close(t->files[fd]);
+    free(t->files);
+    fd_table_init(t);
+}
+
+/* Grows T to have at least CNT slots, and at least double its
+   current size.  Returns false if memory allocation fails. */
+static bool fd_table_grow(struct fd_table *t, int cnt)
+{
+    int new_cnt = t->cnt > 0 ? t->cnt * 2 : FD_TABLE_MIN;
+    if (new_cnt < cnt)
+        new_cnt = cnt;
+
+    struct file **files = realloc(t->files, new_cnt * sizeof *files);
+    if (files == NULL)
+        return false;
+
+    memset(files + t->cnt, 0, (new_cnt - t->cnt) * sizeof *files);
+    t->files = files;
+    t->cnt = new_cnt;
+    return true;
+}
+
+/* Installs FILE in the lowest free file descriptor of T, 2 or
+   more, growing T if it is full.  Returns the new file
+   descriptor, or -1 if memory allocation fails. */
+int fd_table_add(struct fd_table *t, struct file *file)
+{
+    int fd;
+
+    for (fd = t->free; fd < t->cnt; fd++)
+        if (t->files[fd] == NULL)
+            break;
+
+    if (fd >= FD_MAX || (fd >= t->cnt && !fd_table_grow(t, fd + 1)))
+        return -1;
+
+    t->files[fd] = file;
+    t->free = fd + 1;
+    return fd;
+}
+
+/* Installs FILE as file descriptor FD in T, closing any file that
+   FD referred to before.  Returns false if FD is out of range or
+   memory allocation fails. */
+bool fd_table_set(struct fd_table *t, int fd, struct file *file)
+{
+    if (fd < 0 || fd >= FD_MAX || (fd >= t->cnt && !fd_table_grow(t, fd + 1)))
+        return false;
+
+    file_close(t->files[fd]);
+    t->files[fd] = file;
+    return true;
+}
+
+/* Returns the file open as FD in T, or a null pointer if FD is
+   not open. */
+struct file *fd_table_get(const struct fd_table *t, int fd)
+{
+    if (fd < 0 || fd >= t->cnt)
+        return NULL;
+    return t->files[fd];
+}
+
+/* Removes FD from T, making it available for reuse.  Returns the
+   file that was open as FD, which the caller must close, or a
+   null pointer if FD is not open. */
+struct file *fd_table_remove(struct fd_table *t, int fd)
+{
+    struct file *file = fd_table_get(t, fd);
+
+    if (file != NULL)
+    {
+        t->files[fd] = NULL;
+        if (fd >= 2 && fd < t->free)
+            t->free = fd;
     }
+    return file;
+}
+
+/* Installs FILE in the lowest free file descriptor of the current
+   process.  Returns the new file descriptor, or -1 if memory
+   allocation fails. */
+int process_add_file(struct file *file)
+{
+    struct process *self = thread_current()->process;
+    int fd;
+
+    lock_acquire(&self->fds_lock);
+    fd = fd_table_add(&self->fds, file);
+    lock_release(&self->fds_lock);
+    return fd;
+}
 
+/* Returns a new reference to the file open as FD in the current
+   process, which the caller must close, or a null pointer if FD
+   is not open.  The reference keeps the file usable even if
+   another thread closes FD meanwhile.  Console descriptors that
+   have not been redirected to a file are not open. */
+struct file *process_get_file(int fd)
+{
+    struct process *self = thread_current()->process;
+    struct file *file;
+
+    lock_acquire(&self->fds_lock);
+    file = fd_table_get(&self->fds, fd);
+    if (file != NULL)
+        file_dup(file);
+    lock_release(&self->fds_lock);
+    return file;
+}
+
+/* Removes FD from the current process's descriptor table.
+   Returns the file that was open as FD, which the caller must
+   close, or a null pointer if FD is not open. */
+struct file *process_remove_file(int fd)
+{
+    struct process *self = thread_current()->process;
+    struct file *file;
+
+    lock_acquire(&self->fds_lock);
+    file = fd_table_remove(&self->fds, fd);
+    lock_release(&self->fds_lock);
+    return file;
+}
+
+/* Initializes DST as a copy of the current process's descriptor
+   table.  Returns false if memory allocation fails. */
+bool process_copy_files(struct fd_table *dst)
+{
+    struct process *self = thread_current()->process;
+    bool ok;
+
+    lock_acquire(&self->fds_lock);
+    ok = fd_table_copy(dst, &self->fds);
+    lock_release(&self->fds_lock);
+    return ok;
+}
+
+/* Returns the top of the user stack in SLOT, for a thread other
+   than its process's initial thread.  The stacks lie below the
+   region kept for the initial thread's stack, each under a guard
+   page that is never mapped. */
+static uint8_t *thread_stack_top(int slot)
+{
+#ifdef VM
+    uint8_t *base = page_stack_bottom();
+#else
+    uint8_t *base = (uint8_t *)PHYS_BASE - PGSIZE;
+#endif
+
+    return base - (slot * (USER_THREAD_STACK_PAGES + 1) + 1) * PGSIZE;
+}
+
+/* Unmaps the top PAGE_CNT pages of the stack in SLOT. */
+static void free_thread_stack(int slot, int page_cnt)
+{
+    uint8_t *top = thread_stack_top(slot);
+
+    for (int i = 1; i <= page_cnt; i++)
+    {
+        uint8_t *upage = top - i * PGSIZE;
+#ifdef VM
+        page_deallocate(upage);
+#else
+        uint32_t *pd = thread_current()->pagedir;
+        void *kpage = pagedir_get_page(pd, upage);
+
+        pagedir_clear_page(pd, upage);
+        palloc_free_page(kpage);
+#endif
+    }
+}
+
+/* Maps the stack in SLOT into the current process.  Returns true
+   if successful, false if memory allocation fails or part of the
+   stack is already in use. */
+static bool alloc_thread_stack(int slot)
+{
+    uint8_t *top = thread_stack_top(slot);
+
+    for (int i = 1; i <= USER_THREAD_STACK_PAGES; i++)
+    {
+        uint8_t *upage = top - i * PGSIZE;
+#ifdef VM
+        bool ok = page_allocate(upage, true) != NULL;
+#else
+        uint8_t *kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+        bool ok = kpage != NULL && install_page(upage, kpage, true);
+        if (!ok)
+            palloc_free_page(kpage);
+#endif
+        if (!ok)
+        {
+            free_thread_stack(slot, i - 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns the thread TID of process P, or a null pointer if P has
+   no such thread besides its initial one.  P's thread_lock must
+   be held. */
+static struct user_thread *find_user_thread(struct process *p, tid_t tid)
+{
+    for (struct list_elem *e = list_begin(&p->threads); e != list_end(&p->threads);
+         e = list_next(e))
+    {
+        struct user_thread *ut = list_entry(e, struct user_thread, elem);
+        if (ut->tid == tid)
+            return ut;
+    }
     return NULL;
 }
 
+/* Starts a new thread in the current process, sharing its address
+   space and open files.  The thread begins running user code at
+   EIP on a stack of its own, with ARG0 and ARG1 as the arguments
+   of a function called from a null return address.  Returns the
+   new thread's id, or TID_ERROR if the process has USER_THREAD_MAX
+   threads besides its initial one or memory is short. */
+tid_t process_thread_create(void *eip, void *arg0, void *arg1)
+{
+    struct thread *cur = thread_current();
+    struct process *self = cur->process;
+    struct thread_start *start = malloc(sizeof *start);
+    struct user_thread *ut = malloc(sizeof *ut);
+    tid_t tid = TID_ERROR;
+    int slot = -1;
+
+    /* Claim a free stack. */
+    lock_acquire(&self->thread_lock);
+    for (int i = 0; i < USER_THREAD_MAX && !self->exiting; i++)
+        if ((self->stack_slots & (1u << i)) == 0)
+        {
+            self->stack_slots |= 1u << i;
+            slot = i;
+            break;
+        }
+    lock_release(&self->thread_lock);
+
+    if (start != NULL && ut != NULL && slot != -1 && alloc_thread_stack(slot))
+    {
+        ut->tid = TID_ERROR;
+        ut->slot = slot;
+        ut->done = false;
+        ut->joined = false;
+        start->process = self;
+        start->ut = ut;
+        start->eip = eip;
+        start->arg0 = arg0;
+        start->arg1 = arg1;
+
+        /* Count the thread before it can run, so that the process
+           does not go away under it. */
+        lock_acquire(&self->thread_lock);
+        list_push_back(&self->threads, &ut->elem);
+        self->thread_cnt++;
+        lock_release(&self->thread_lock);
+
+        tid = thread_create(cur->name, PRI_DEFAULT, start_thread, start);
+
+        lock_acquire(&self->thread_lock);
+        if (tid != TID_ERROR)
+            ut->tid = tid;
+        else
+        {
+            list_remove(&ut->elem);
+            self->thread_cnt--;
+        }
+        lock_release(&self->thread_lock);
+
+        if (tid != TID_ERROR)
+            return tid;
+        free_thread_stack(slot, USER_THREAD_STACK_PAGES);
+    }
+
+    if (slot != -1)
+    {
+        lock_acquire(&self->thread_lock);
+        self->stack_slots &= ~(1u << slot);
+        lock_release(&self->thread_lock);
+    }
+    free(start);
+    free(ut);
+    return TID_ERROR;
+}
+
+/* A thread function that joins the process given in START_ and
+   starts running its user code. */
+static void start_thread(void *start_)
+{
+    struct thread_start *start = start_;
+    struct thread *cur = thread_current();
+    struct process *self = start->process;
+    struct intr_frame if_;
+    esp_t esp;
+
+    /* thread_create() made a process for us, which we do not
+       need.  Adopt the address space of the one we belong to. */
+    cur->process->status = PROCESS_EXITED;
+    process_free(cur->process);
+    cur->process = self;
+    cur->pagedir = self->thread->pagedir;
+#ifdef VM
+    cur->pages = self->thread->pages;
+#endif
+    process_activate();
+
+    /* Our creator may not have recorded our tid yet. */
+    lock_acquire(&self->thread_lock);
+    start->ut->tid = cur->tid;
+    lock_release(&self->thread_lock);
+
+    /* Push the arguments and a null return address. */
+    esp.vp = thread_stack_top(start->ut->slot);
+    *(--esp.vpp) = start->arg1;
+    *(--esp.vpp) = start->arg0;
+    *(--esp.rap) = NULL;
+
+    memset(&if_, 0, sizeof if_);
+    if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+    if_.cs = SEL_UCSEG;
+    if_.eflags = FLAG_IF | FLAG_MBS;
+    if_.eip = (void (*)(void))start->eip;
+    if_.esp = esp.vp;
+    free(start);
+
+    /* The process may have been terminated while we started. */
+    process_return_to_user();
+
+    /* Start the thread as start_process() does. */
+    asm volatile(
+        "movl %0, %%esp; \
+         jmp intr_exit"
+        :
+        : "g"(&if_)
+        : "memory");
+    NOT_REACHED();
+}
+
+/* Waits for thread TID of the current process to exit.  Returns 0
+   once it has, or -1 immediately if TID is not a thread of the
+   process besides its initial thread, if it has already been
+   joined, or if the process is being terminated. */
+int process_thread_join(tid_t tid)
+{
+    struct process *self = thread_current()->process;
+    struct user_thread *ut;
+    int result = -1;
+
+    lock_acquire(&self->thread_lock);
+    ut = find_user_thread(self, tid);
+    if (ut != NULL && !ut->joined)
+    {
+        ut->joined = true;
+        while (!ut->done && !self->exiting)
+            cond_wait(&self->thread_exited, &self->thread_lock);
+        if (ut->done)
+        {
+            list_remove(&ut->elem);
+            free(ut);
+            result = 0;
+        }
+    }
+    lock_release(&self->thread_lock);
+
+    return result;
+}
+
+/* Exits the current thread.  The initial thread of a process
+   waits for the others, and the process exits with status 0 once
+   they are done, unless it is terminated first. */
+void process_thread_exit(void)
+{
+    struct thread *cur = thread_current();
+    struct process *self = cur->process;
+
+    if (cur == self->thread)
+    {
+        lock_acquire(&self->thread_lock);
+        if (!self->exiting)
+            self->exit_code = 0;
+        lock_release(&self->thread_lock);
+    }
+    thread_exit();
+}
+
+/* Releases the stack of the current thread, which is not its
+   process's initial thread, and wakes the threads waiting for it
+   to exit. */
+static void exit_user_thread(void)
+{
+    struct thread *cur = thread_current();
+    struct process *self = cur->process;
+    struct user_thread *ut;
+
+    lock_acquire(&self->thread_lock);
+    ut = find_user_thread(self, cur->tid);
+    lock_release(&self->thread_lock);
+    ASSERT(ut != NULL);
+
+    free_thread_stack(ut->slot, USER_THREAD_STACK_PAGES);
+
+    /* The page directory belongs to the initial thread.  As in
+       process_exit(), forget it before switching away from it. */
+    cur->pagedir = NULL;
+#ifdef VM
+    cur->pages = NULL;
+#endif
+    pagedir_activate(NULL);
+
+    /* SELF may be freed as soon as the lock is released. */
+    lock_acquire(&self->thread_lock);
+    self->stack_slots &= ~(1u << ut->slot);
+    ut->done = true;
+    self->thread_cnt--;
+    cond_broadcast(&self->thread_exited, &self->thread_lock);
+    lock_release(&self->thread_lock);
+}
+
 /* Set process status when load failed. */
 static void process_load_fail(void)
 {
@@ -661,13 +1722,11 @@ static void process_load_fail(void)
 }
 
 /* Set process status when load successed. */
-static void process_load_success(const char *cmd)
+static void process_load_success(void)
 {
     struct process *self = thread_current()->process;
 
     self->status = PROCESS_NORMAL;
-    self->file = filesys_open(cmd);
-    file_deny_write(self->file);
 
     sema_up(&self->sema_load);
 }
@@ -1,14 +1,25 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <hash.h>
 #include <list.h>
 #include "threads/thread.h"
 #include "threads/synch.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#ifdef VM
+#include "vm/mmap.h"
+#endif
 
 typedef int pid_t;
 
+/* Default maximum number of user processes. */
+#define PROCESS_LIMIT_DEFAULT 256
+
+/* Maximum number of user processes.
+   Controlled by kernel command-line option "-pl=COUNT". */
+extern int process_limit;
+
 /* States in a user process's life cycle. */
 enum process_status
 {
@@ -18,31 +29,103 @@ enum process_status
     PROCESS_EXITED,  /* Exited normally. */
 };
 
-/* Contains the infos that should not be discarded when thread exit. */
+/* Highest file descriptor number, plus one. */
+#define FD_MAX 4096
+
+/* A file descriptor table.  Descriptors 0 and 1 refer to the
+   console unless a file has been installed in their slots. */
+struct fd_table
+{
+    struct file **files; /* Open files, indexed by fd. */
+    int cnt;             /* Number of slots in FILES. */
+    int free;            /* No free fd of 2 or more below this one. */
+};
+
+/* Largest number of threads in a user process, besides its
+   initial thread. */
+#define USER_THREAD_MAX 32
+
+/* Size of the stack of each thread in a user process besides its
+   initial thread, in pages. */
+#define USER_THREAD_STACK_PAGES 8
+
+/* Contains the infos that should not be discarded when thread exit.
+
+   A process may run several threads that share its page directory
+   and open files.  THREAD, the initial thread, owns the address
+   space and tears it down after the others have exited. */
 struct process
 {
     struct thread *thread;      /* Pointer to struct thread. */
     pid_t pid;                  /* Process identifier. */
     enum process_status status; /* Process state. */
     int exit_code;              /* Exit code. */
-    struct list_elem allelem;   /* List element for all processes list. */
+    struct hash_elem hash_elem; /* Element in process table. */
     struct list_elem elem;      /* List element for children list. */
-    struct list children;       /* List of children. */
-    struct process *parent;     /* Parent. */
+    struct list children;       /* Children, under process_lock. */
+    struct process *parent;     /* Parent, under process_lock, or null. */
     struct semaphore sema_load; /* Parent block on this while loading. */
     struct semaphore sema_wait; /* Parent block on this while waiting. */
-    struct list files;          /* Opening files. */
-    int fd;                     /* Max file descriptor num. */
+    struct fd_table fds;        /* Open files. */
+    struct lock fds_lock;       /* Protects FDS. */
     struct file *file;          /* Executable file loaded by self. */
+
+    /* Threads besides the initial one, protected by THREAD_LOCK. */
+    struct lock thread_lock;           /* Protects these members. */
+    struct condition thread_exited;    /* Signaled when a thread exits. */
+    struct list threads;               /* struct user_thread, by creation. */
+    int thread_cnt;                    /* Threads that have not exited. */
+    uint32_t stack_slots;              /* Thread stacks in use, one bit each. */
+    bool exiting;                      /* Terminating all threads? */
+#ifdef VM
+    struct lock mm_lock;         /* Serializes mapping and unmapping. */
+    struct list mappings;        /* Memory-mapped files. */
+    mapid_t mapid;               /* Next mapping identifier. */
+    struct list shm_attachments; /* Attached shared memory. */
+
+    /* Working set, owned by vm/wset.c. */
+    size_t resident_cnt;  /* Pages in frames. */
+    size_t resident_peak; /* Largest resident_cnt so far. */
+    int64_t start_time;   /* Timer tick of creation. */
+    int64_t last_fault;   /* Timer tick of the last page-in. */
+    unsigned fault_cnt;   /* Page-ins. */
+    unsigned evict_cnt;   /* Pages taken by page replacement. */
+    unsigned suspend_cnt; /* Times suspended by load control. */
+#endif
 };
 
 void process_init(void);
+void process_reaper_start(void);
+void process_done(void);
+void process_file_removed(void);
 tid_t process_execute(const char *file_name);
+tid_t process_spawn(const char *cmd_line, struct fd_table *);
 int process_wait(tid_t);
 void process_exit(void);
+void process_terminate(int status) NO_RETURN;
+void process_return_to_user(void);
+bool process_exiting(void);
 void process_activate(void);
 struct process *process_create(struct thread *t);
 struct process *get_process(pid_t pid);
 struct process *get_child(pid_t pid);
+void process_free(struct process *);
+
+void fd_table_init(struct fd_table *);
+bool fd_table_copy(struct fd_table *dst, const struct fd_table *src);
+void fd_table_destroy(struct fd_table *);
+int fd_table_add(struct fd_table *, struct file *);
+bool fd_table_set(struct fd_table *, int fd, struct file *);
+struct file *fd_table_get(const struct fd_table *, int fd);
+struct file *fd_table_remove(struct fd_table *, int fd);
+
+int process_add_file(struct file *);
+struct file *process_get_file(int fd);
+struct file *process_remove_file(int fd);
+bool process_copy_files(struct fd_table *);
+
+tid_t process_thread_create(void *eip, void *arg0, void *arg1);
+int process_thread_join(tid_t);
+void process_thread_exit(void) NO_RETURN;
 
 #endif /* userprog/process.h */
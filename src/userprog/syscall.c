@@ -2,16 +2,27 @@
 #include "lib/stdio.h"
 #include "lib/kernel/stdio.h"
 #include <syscall-nr.h>
+#include <spawn.h>
+#include <uio.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "userprog/futex.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "userprog/uaccess.h"
 #include "devices/shutdown.h"
 #include "devices/input.h"
+#include "filesys/pipe.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#include "vm/shm.h"
+#endif
 
 #define USER_ASSERT(CONDITION) \
     if (CONDITION)             \
@@ -22,18 +33,17 @@
         exit(-1);              \
     }
 
-static struct open_file
-{
-    int fd;
-    struct file *file;
-    struct list_elem elem;
-};
-
 static void syscall_handler(struct intr_frame *);
 static bool is_valid_ptr(const void *ptr);
 static bool is_user_mem(const void *start, size_t size);
-static bool is_valid_str(const char *str);
-static struct open_file *get_file_by_fd(const int fd);
+static char *copy_in_string(const char *ustr);
+static struct file *get_file_by_fd(int fd);
+static struct file *get_file_or_console(int fd, int console_fd);
+static bool is_console(int fd);
+#ifdef VM
+static bool pin_user_mem(const void *start, size_t size, bool will_write);
+static void unpin_user_mem(const void *start, size_t size);
+#endif
 
 static void halt(void) NO_RETURN;
 static void exit(int status) NO_RETURN;
@@ -48,95 +58,301 @@ static int write(int fd, const void *buffer, unsigned length);
 static void seek(int fd, unsigned position);
 static unsigned tell(int fd);
 static void close(int fd);
+static int pread(int fd, void *buffer, unsigned length, unsigned offset);
+static int pwrite(int fd, const void *buffer, unsigned length, unsigned offset);
+static int readv(int fd, const struct iovec *iov, int iovcnt);
+static int writev(int fd, const struct iovec *iov, int iovcnt);
+static int copy_file_range(int fd_in, int fd_out, unsigned length);
+static pid_t spawn(const char *cmd_line, const struct spawn_action *, int action_cnt);
+static int pipe(int *fds);
+static tid_t create_thread(void *eip, void *arg0, void *arg1);
+static int join_thread(tid_t);
+static void exit_thread(void) NO_RETURN;
+static bool futex_wait(const int *uaddr, int val);
+static int futex_wake(const int *uaddr, int cnt);
+#ifdef VM
+static mapid_t mmap(int fd, void *addr);
+static void munmap(mapid_t mapping);
+static int shm_open(const char *name, unsigned size);
+static bool shm_attach(int shmid, void *addr);
+static bool shm_detach(void *addr);
+static bool shm_unlink(const char *name);
+#endif
+
+/* Argument decoders, one per system call.  ARGS points to the
+    system call's arguments, already copied in from the user stack.
+    The return value is passed back to the user in eax. */
+static uint32_t sys_halt(const uint32_t *args UNUSED)
+{
+    halt();
+}
 
-static struct lock file_lock;
+static uint32_t sys_exit(const uint32_t *args)
+{
+    exit((int)args[0]);
+}
 
-void syscall_init(void)
+static uint32_t sys_exec(const uint32_t *args)
 {
-    intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
+    return exec((const char *)args[0]);
+}
 
-    lock_init(&file_lock);
+static uint32_t sys_wait(const uint32_t *args)
+{
+    return wait((pid_t)args[0]);
 }
 
-static void syscall_handler(struct intr_frame *f)
+static uint32_t sys_create(const uint32_t *args)
+{
+    return create((const char *)args[0], (unsigned)args[1]);
+}
+
+static uint32_t sys_remove(const uint32_t *args)
+{
+    return remove((const char *)args[0]);
+}
+
+static uint32_t sys_open(const uint32_t *args)
+{
+    return open((const char *)args[0]);
+}
+
+static uint32_t sys_filesize(const uint32_t *args)
+{
+    return filesize((int)args[0]);
+}
+
+static uint32_t sys_read(const uint32_t *args)
 {
-    USER_ASSERT(is_user_mem(f->esp, sizeof(void *)));
+    return read((int)args[0], (void *)args[1], (unsigned)args[2]);
+}
 
-    void *args[4];
-    for (size_t i = 0; i != 4; ++i)
-        args[i] = f->esp + i * sizeof(void *);
+static uint32_t sys_write(const uint32_t *args)
+{
+    return write((int)args[0], (const void *)args[1], (unsigned)args[2]);
+}
 
-    int syscall_num = *(int *)args[0];
+static uint32_t sys_seek(const uint32_t *args)
+{
+    seek((int)args[0], (unsigned)args[1]);
+    return 0;
+}
+
+static uint32_t sys_tell(const uint32_t *args)
+{
+    return tell((int)args[0]);
+}
+
+static uint32_t sys_close(const uint32_t *args)
+{
+    close((int)args[0]);
+    return 0;
+}
+
+static uint32_t sys_pread(const uint32_t *args)
+{
+    return pread((int)args[0], (void *)args[1], (unsigned)args[2], (unsigned)args[3]);
+}
 
-    /* Check validation. */
-    switch (syscall_num)
+static uint32_t sys_pwrite(const uint32_t *args)
+{
+    return pwrite((int)args[0], (const void *)args[1], (unsigned)args[2], (unsigned)args[3]);
+}
+
+static uint32_t sys_readv(const uint32_t *args)
+{
+    return readv((int)args[0], (const struct iovec *)args[1], (int)args[2]);
+}
+
+static uint32_t sys_writev(const uint32_t *args)
+{
+    return writev((int)args[0], (const struct iovec *)args[1], (int)args[2]);
+}
+
+static uint32_t sys_copy_file_range(const uint32_t *args)
+{
+    return copy_file_range((int)args[0], (int)args[1], (unsigned)args[2]);
+}
+
+static uint32_t sys_spawn(const uint32_t *args)
+{
+    return spawn((const char *)args[0], (const struct spawn_action *)args[1], (int)args[2]);
+}
+
+static uint32_t sys_pipe(const uint32_t *args)
+{
+    return pipe((int *)args[0]);
+}
+
+static uint32_t sys_thread_create(const uint32_t *args)
+{
+    return create_thread((void *)args[0], (void *)args[1], (void *)args[2]);
+}
+
+static uint32_t sys_thread_join(const uint32_t *args)
+{
+    return join_thread((tid_t)args[0]);
+}
+
+static uint32_t sys_thread_exit(const uint32_t *args UNUSED)
+{
+    exit_thread();
+}
+
+static uint32_t sys_futex_wait(const uint32_t *args)
+{
+    return futex_wait((const int *)args[0], (int)args[1]);
+}
+
+static uint32_t sys_futex_wake(const uint32_t *args)
+{
+    return futex_wake((const int *)args[0], (int)args[1]);
+}
+
+#ifdef VM
+static uint32_t sys_mmap(const uint32_t *args)
+{
+    return mmap((int)args[0], (void *)args[1]);
+}
+
+static uint32_t sys_munmap(const uint32_t *args)
+{
+    munmap((mapid_t)args[0]);
+    return 0;
+}
+
+static uint32_t sys_shm_open(const uint32_t *args)
+{
+    return shm_open((const char *)args[0], (unsigned)args[1]);
+}
+
+static uint32_t sys_shm_attach(const uint32_t *args)
+{
+    return shm_attach((int)args[0], (void *)args[1]);
+}
+
+static uint32_t sys_shm_detach(const uint32_t *args)
+{
+    return shm_detach((void *)args[0]);
+}
+
+static uint32_t sys_shm_unlink(const uint32_t *args)
+{
+    return shm_unlink((const char *)args[0]);
+}
+#endif
+
+/* Maximum number of arguments to a system call. */
+#define SYSCALL_MAX_ARGS 4
+
+/* A system call. */
+struct syscall
+{
+    uint32_t (*func)(const uint32_t *args); /* Argument decoder. */
+    size_t argc;                            /* Number of arguments. */
+    const char *name;                       /* Name, for statistics. */
+};
+
+/* System calls, indexed by number.  Null FUNC for unimplemented. */
+static const struct syscall syscalls[] = {
+    [SYS_HALT] = {sys_halt, 0, "halt"},
+    [SYS_EXIT] = {sys_exit, 1, "exit"},
+    [SYS_EXEC] = {sys_exec, 1, "exec"},
+    [SYS_WAIT] = {sys_wait, 1, "wait"},
+    [SYS_CREATE] = {sys_create, 2, "create"},
+    [SYS_REMOVE] = {sys_remove, 1, "remove"},
+    [SYS_OPEN] = {sys_open, 1, "open"},
+    [SYS_FILESIZE] = {sys_filesize, 1, "filesize"},
+    [SYS_READ] = {sys_read, 3, "read"},
+    [SYS_WRITE] = {sys_write, 3, "write"},
+    [SYS_SEEK] = {sys_seek, 2, "seek"},
+    [SYS_TELL] = {sys_tell, 1, "tell"},
+    [SYS_CLOSE] = {sys_close, 1, "close"},
+#ifdef VM
+    [SYS_MMAP] = {sys_mmap, 2, "mmap"},
+    [SYS_MUNMAP] = {sys_munmap, 1, "munmap"},
+#endif
+    [SYS_PREAD] = {sys_pread, 4, "pread"},
+    [SYS_PWRITE] = {sys_pwrite, 4, "pwrite"},
+    [SYS_READV] = {sys_readv, 3, "readv"},
+    [SYS_WRITEV] = {sys_writev, 3, "writev"},
+    [SYS_COPY_FILE_RANGE] = {sys_copy_file_range, 3, "copy_file_range"},
+    [SYS_SPAWN] = {sys_spawn, 3, "spawn"},
+    [SYS_PIPE] = {sys_pipe, 1, "pipe"},
+#ifdef VM
+    [SYS_SHM_OPEN] = {sys_shm_open, 2, "shm_open"},
+    [SYS_SHM_ATTACH] = {sys_shm_attach, 2, "shm_attach"},
+    [SYS_SHM_DETACH] = {sys_shm_detach, 1, "shm_detach"},
+    [SYS_SHM_UNLINK] = {sys_shm_unlink, 1, "shm_unlink"},
+#endif
+    [SYS_THREAD_CREATE] = {sys_thread_create, 3, "thread_create"},
+    [SYS_THREAD_JOIN] = {sys_thread_join, 1, "thread_join"},
+    [SYS_THREAD_EXIT] = {sys_thread_exit, 0, "thread_exit"},
+    [SYS_FUTEX_WAIT] = {sys_futex_wait, 2, "futex_wait"},
+    [SYS_FUTEX_WAKE] = {sys_futex_wake, 2, "futex_wake"},
+};
+
+/* Number of entries in syscalls[]. */
+#define SYSCALL_CNT (sizeof syscalls / sizeof *syscalls)
+
+/* Calls of each system call, and their total cost in cycles.
+   Calls that do not return, such as exit, count no cycles. */
+static long long syscall_cnt[SYSCALL_CNT];
+static long long syscall_cycles[SYSCALL_CNT];
+
+void syscall_init(void)
+{
+    intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
+}
+
+/* Prints system call statistics. */
+void syscall_print_stats(void)
+{
+    for (size_t i = 0; i < SYSCALL_CNT; i++)
     {
-    case SYS_READ:
-    case SYS_WRITE:
-        USER_ASSERT(is_user_mem(args[3], sizeof(void *)));
-    case SYS_CREATE:
-    case SYS_SEEK:
-        USER_ASSERT(is_user_mem(args[2], sizeof(void *)));
-    case SYS_EXIT:
-    case SYS_EXEC:
-    case SYS_WAIT:
-    case SYS_REMOVE:
-    case SYS_OPEN:
-    case SYS_FILESIZE:
-    case SYS_TELL:
-    case SYS_CLOSE:
-        USER_ASSERT(is_user_mem(args[1], sizeof(void *)));
-    case SYS_HALT:
-        break;
-    default:
-        NOT_REACHED();
+        if (syscall_cnt[i] == 0)
+            continue;
+
+        printf("Syscall: %-15s %lld calls, %lld cycles avg\n",
+               syscalls[i].name, syscall_cnt[i],
+               syscall_cycles[i] / syscall_cnt[i]);
     }
+}
 
-    /* Forward. */
-    switch (syscall_num)
+static void syscall_handler(struct intr_frame *f)
+{
+#ifdef VM
+    /* Kernel-mode faults on the user stack need the user's esp. */
+    thread_current()->user_esp = f->esp;
+#endif
+
+    const struct syscall *sc;
+    uint32_t syscall_num;
+    uint32_t args[SYSCALL_MAX_ARGS];
+    enum intr_level old_level;
+    uint64_t start;
+
+    USER_ASSERT(copy_from_user(&syscall_num, f->esp, sizeof syscall_num));
+    if (syscall_num >= SYSCALL_CNT || syscalls[syscall_num].func == NULL)
     {
-    case SYS_HALT:
-        halt();
-        NOT_REACHED();
-    case SYS_EXIT:
-        exit(*(int *)args[1]);
-        NOT_REACHED();
-    case SYS_EXEC:
-        f->eax = exec(*(const char **)args[1]);
-        break;
-    case SYS_WAIT:
-        f->eax = wait(*(pid_t *)args[1]);
-        break;
-    case SYS_CREATE:
-        f->eax = create(*(const char **)args[1], *(unsigned *)args[2]);
-        break;
-    case SYS_REMOVE:
-        f->eax = remove(*(const char **)args[1]);
-        break;
-    case SYS_OPEN:
-        f->eax = open(*(const char **)args[1]);
-        break;
-    case SYS_FILESIZE:
-        f->eax = filesize(*(int *)args[1]);
-        break;
-    case SYS_READ:
-        f->eax = read(*(int *)args[1], *(void **)args[2], *(unsigned *)args[3]);
-        break;
-    case SYS_WRITE:
-        f->eax = write(*(int *)args[1], *(const void **)args[2], *(unsigned *)args[3]);
-        break;
-    case SYS_SEEK:
-        seek(*(int *)args[1], *(unsigned *)args[2]);
-        break;
-    case SYS_TELL:
-        f->eax = tell(*(int *)args[1]);
-        break;
-    case SYS_CLOSE:
-        close(*(int *)args[1]);
-        break;
-    default:
-        NOT_REACHED();
+        f->eax = -1;
+        return;
     }
+
+    /* Copy in all the arguments at once. */
+    sc = &syscalls[syscall_num];
+    USER_ASSERT(copy_from_user(args, (uint32_t *)f->esp + 1, sc->argc * sizeof *args));
+
+    old_level = intr_disable();
+    syscall_cnt[syscall_num]++;
+    intr_set_level(old_level);
+
+    start = cpu_rdtsc();
+    f->eax = sc->func(args);
+
+    old_level = intr_disable();
+    syscall_cycles[syscall_num] += cpu_rdtsc() - start;
+    intr_set_level(old_level);
 }
 
 /* Returns true if PTR is not a null pointer,
@@ -144,10 +360,21 @@ static void syscall_handler(struct intr_frame *f)
     or a pointer to unmapped virtual memory. */
 static bool is_valid_ptr(const void *ptr)
 {
-    return ptr != NULL && is_user_vaddr(ptr) && pagedir_get_page(thread_current()->pagedir, ptr) != NULL;
+    if (ptr == NULL || !is_user_vaddr(ptr))
+        return false;
+    if (pagedir_get_page(thread_current()->pagedir, ptr) != NULL)
+        return true;
+#ifdef VM
+    /* Not resident yet, but will be faulted in on access. */
+    return page_for_addr(ptr) != NULL;
+#else
+    return false;
+#endif
 }
 
-/* Returns true if [START, START + SIZE) is all valid. */
+/* Returns true if [START, START + SIZE) is all valid.
+    Buffers handed to the file system are checked this way up front,
+    because a fault inside the file system cannot be fixed up. */
 static bool is_user_mem(const void *start, size_t size)
 {
     for (const void *ptr = start; ptr < start + size; ptr += PGSIZE)
@@ -162,54 +389,113 @@ static bool is_user_mem(const void *start, size_t size)
     return true;
 }
 
-/* Returns true if STR is a valid string in user space. */
-static bool is_valid_str(const char *str)
+/* Copies the string at user address USTR into a new page and
+    returns it.  Terminates the process if USTR is not a valid
+    string shorter than a page.  Returns a null pointer if memory
+    cannot be allocated. */
+static char *copy_in_string(const char *ustr)
 {
-    if (!is_valid_ptr(str))
-        return false;
+    char *kstr = palloc_get_page(0);
+    if (kstr == NULL)
+        return NULL;
 
-    for (const char *c = str; *c != '\0';)
+    if (strncpy_from_user(kstr, ustr, PGSIZE) < 0)
     {
-        ++c;
-        if (c - str + 2 == PGSIZE || !is_valid_ptr(c))
-            return false;
+        palloc_free_page(kstr);
+        exit(-1);
     }
 
-    return true;
+    return kstr;
 }
 
-static struct open_file *get_file_by_fd(const int fd)
+#ifdef VM
+/* Pins every page in [START, START + SIZE) so that the file system
+    can access it without faulting.  WILL_WRITE requires the pages
+    to be writable.  Returns false, with nothing pinned, on failure. */
+static bool pin_user_mem(const void *start, size_t size, bool will_write)
 {
-    struct list *l = &thread_current()->process->files;
+    if (size == 0)
+        return true;
 
-    for (struct list_elem *e = list_begin(l); e != list_end(l); e = list_next(e))
+    const void *first = pg_round_down(start);
+    const void *last = pg_round_down(start + size - 1);
+
+    for (const void *upage = first; upage <= last; upage += PGSIZE)
     {
-        struct open_file *f = list_entry(e, struct open_file, elem);
-        if (f->fd == fd)
-            return f;
+        if (!page_lock(upage, will_write))
+        {
+            while (upage != first)
+            {
+                upage -= PGSIZE;
+                page_unlock(upage);
+            }
+            return false;
+        }
     }
 
-    USER_ASSERT(false);
+    return true;
+}
+
+/* Unpins the pages pinned by pin_user_mem(START, SIZE). */
+static void unpin_user_mem(const void *start, size_t size)
+{
+    if (size == 0)
+        return;
+
+    const void *last = pg_round_down(start + size - 1);
+
+    for (const void *upage = pg_round_down(start); upage <= last; upage += PGSIZE)
+        page_unlock(upage);
+}
+#endif
+
+/* Returns a reference to the file open as FD in the current
+    process, which the caller must close.  Terminates the process if
+    FD is not open. */
+static struct file *get_file_by_fd(int fd)
+{
+    struct file *f = process_get_file(fd);
+
+    USER_ASSERT(f != NULL);
+    return f;
+}
+
+/* Returns a reference to the file open as FD in the current
+    process, which the caller must close, or a null pointer if FD is
+    CONSOLE_FD and refers to the console.  Terminates the process if
+    FD is neither. */
+static struct file *get_file_or_console(int fd, int console_fd)
+{
+    struct file *f = process_get_file(fd);
+
+    USER_ASSERT(f != NULL || fd == console_fd);
+    return f;
+}
+
+/* Returns true if FD refers to the console in the current
+    process. */
+static bool is_console(int fd)
+{
+    struct file *f;
+
+    if (fd != STDIN_FILENO && fd != STDOUT_FILENO)
+        return false;
+
+    f = process_get_file(fd);
+    file_close(f);
+    return f == NULL;
 }
 
 /* Terminates the current user program, returning
     STATUS to the kernel. If the process’s parent
     waits for it, this is the status that will be
     returned. Conventionally, a status of 0 indicates
-    success and nonzero values indicate errors. */
+    success and nonzero values indicate errors.  Every thread of
+    the program exits with it. */
 static void exit(int status)
 {
-    struct process *self = thread_current()->process;
-
-    while (!list_empty(&self->files))
-    {
-        struct open_file *f = list_entry(list_back(&self->files),
-                                         struct open_file, elem);
-        close(f->fd);
-    }
-
-    self->exit_code = status;
-    thread_exit();
+    /* Open files are closed by process_exit(). */
+    process_terminate(status);
 }
 
 /* Writes SIZE bytes from buffer to the open file FD. Returns the
@@ -231,20 +517,31 @@ static void exit(int status)
 static int write(int fd, const void *buffer, unsigned size)
 {
     USER_ASSERT(is_user_mem(buffer, size));
-    USER_ASSERT(fd != STDIN_FILENO);
 
-    if (fd == STDOUT_FILENO)
+    int ret;
+    struct file *f = get_file_or_console(fd, STDOUT_FILENO);
+
+#ifdef VM
+    if (!pin_user_mem(buffer, size, false))
     {
-        putbuf((const char *)buffer, size);
-        return size;
+        file_close(f);
+        exit(-1);
     }
+#endif
 
-    struct open_file *f = get_file_by_fd(fd);
+    if (f == NULL)
+    {
+        putbuf((const char *)buffer, size);
+        ret = size;
+    }
+    else
+        ret = file_write(f, buffer, size);
 
-    lock_acquire(&file_lock);
-    int ret = file_write(f->file, buffer, size);
-    lock_release(&file_lock);
+#ifdef VM
+    unpin_user_mem(buffer, size);
+#endif
 
+    file_close(f);
     return ret;
 }
 
@@ -259,12 +556,12 @@ static int write(int fd, const void *buffer, unsigned size)
     synchronization to ensure this. */
 static pid_t exec(const char *cmd_line)
 {
-    USER_ASSERT(is_valid_str(cmd_line));
-
-    lock_acquire(&file_lock);
-    pid_t pid = process_execute(cmd_line);
-    lock_release(&file_lock);
+    char *kcmd_line = copy_in_string(cmd_line);
+    if (kcmd_line == NULL)
+        return -1;
 
+    pid_t pid = process_execute(kcmd_line);
+    palloc_free_page(kcmd_line);
     if (pid == TID_ERROR)
         return -1;
 
@@ -274,7 +571,7 @@ static pid_t exec(const char *cmd_line)
     if (child->status == PROCESS_FAILED)
     {
         sema_down(&child->sema_wait);
-        palloc_free_page(child);
+        process_free(child);
         return -1;
     }
     else
@@ -284,6 +581,80 @@ static pid_t exec(const char *cmd_line)
     }
 }
 
+/* Runs CMD_LINE like exec(), but returns as soon as the new
+    process has been created, without waiting for it to load.  If
+    loading fails, the process exits with status -1, which wait()
+    reports.  The new process starts with the caller's file
+    descriptors, sharing their positions, and then applies the
+    ACTION_CNT file actions in ACTIONS in order.  Returns -1 if the
+    process cannot be created or an action fails. */
+static pid_t spawn(const char *cmd_line, const struct spawn_action *actions, int action_cnt)
+{
+    struct spawn_action kactions[SPAWN_ACTION_MAX];
+    struct fd_table fds;
+    char *kcmd_line, *path;
+    bool ok = true, bad = false;
+    pid_t pid = -1;
+
+    if (action_cnt < 0 || action_cnt > SPAWN_ACTION_MAX)
+        return -1;
+    USER_ASSERT(copy_from_user(kactions, actions, action_cnt * sizeof *kactions));
+
+    kcmd_line = copy_in_string(cmd_line);
+    if (kcmd_line == NULL)
+        return -1;
+    path = palloc_get_page(0);
+    if (path == NULL || !process_copy_files(&fds))
+    {
+        palloc_free_page(path);
+        palloc_free_page(kcmd_line);
+        return -1;
+    }
+
+    for (int i = 0; ok && i < action_cnt; i++)
+    {
+        const struct spawn_action *a = &kactions[i];
+        struct file *f = NULL;
+
+        switch (a->type)
+        {
+        case SPAWN_DUP:
+            /* A console descriptor may only be passed on as itself. */
+            f = process_get_file(a->src_fd);
+            if (f == NULL)
+                ok = is_console(a->src_fd) && a->src_fd == a->fd;
+            break;
+        case SPAWN_OPEN:
+            bad = strncpy_from_user(path, a->path, PGSIZE) < 0;
+            f = bad ? NULL : filesys_open(path);
+            ok = f != NULL;
+            break;
+        case SPAWN_CLOSE:
+            file_close(fd_table_remove(&fds, a->fd));
+            continue;
+        default:
+            ok = false;
+            break;
+        }
+
+        if (ok && !fd_table_set(&fds, a->fd, f))
+        {
+            file_close(f);
+            ok = false;
+        }
+    }
+
+    if (ok)
+        pid = process_spawn(kcmd_line, &fds);
+    else
+        fd_table_destroy(&fds);
+    palloc_free_page(path);
+    palloc_free_page(kcmd_line);
+
+    USER_ASSERT(!bad);
+    return pid == TID_ERROR ? -1 : pid;
+}
+
 /* Waits for a child process PID and retrieves the
     child’s exit status.
 
@@ -348,13 +719,13 @@ static void halt(void)
     would require a open system call. */
 static bool create(const char *file, unsigned initial_size)
 {
-    USER_ASSERT(is_valid_str(file));
-
-    lock_acquire(&file_lock);
-    bool ret = filesys_create(file, initial_size);
-    lock_release(&file_lock);
+    char *kfile = copy_in_string(file);
+    if (kfile == NULL)
+        return false;
 
-    return ret;
+    bool success = filesys_create(kfile, initial_size);
+    palloc_free_page(kfile);
+    return success;
 }
 
 /* Deletes the file called FILE. Returns true if successful, false
@@ -362,13 +733,15 @@ static bool create(const char *file, unsigned initial_size)
     or closed, and removing an open file does not close it. */
 static bool remove(const char *file)
 {
-    USER_ASSERT(is_valid_str(file));
-
-    lock_acquire(&file_lock);
-    bool ret = filesys_remove(file);
-    lock_release(&file_lock);
+    char *kfile = copy_in_string(file);
+    if (kfile == NULL)
+        return false;
 
-    return ret;
+    bool success = filesys_remove(kfile);
+    palloc_free_page(kfile);
+    if (success)
+        process_file_removed();
+    return success;
 }
 
 /* Opens the file called FILE. Returns a nonnegative integer handle
@@ -391,35 +764,30 @@ static bool remove(const char *file)
     file position. */
 static int open(const char *file)
 {
-    USER_ASSERT(is_valid_str(file));
-
-    lock_acquire(&file_lock);
-    struct file *f = filesys_open(file);
-    lock_release(&file_lock);
+    char *kfile = copy_in_string(file);
+    if (kfile == NULL)
+        return -1;
 
+    struct file *f = filesys_open(kfile);
+    palloc_free_page(kfile);
     if (f == NULL)
         return -1;
 
-    struct process *self = thread_current()->process;
-
-    struct open_file *open_file = malloc(sizeof(struct open_file));
-    open_file->fd = self->fd++;
-    open_file->file = f;
-    list_push_back(&self->files, &open_file->elem);
+    int fd = process_add_file(f);
+    if (fd == -1)
+        file_close(f);
 
-    return open_file->fd;
+    return fd;
 }
 
 /* Returns the size, in bytes, of the file open as FD. */
 static int filesize(int fd)
 {
-    struct open_file *f = get_file_by_fd(fd);
+    struct file *f = get_file_by_fd(fd);
+    int size = file_length(f);
 
-    lock_acquire(&file_lock);
-    int ret = file_length(f->file);
-    lock_release(&file_lock);
-
-    return ret;
+    file_close(f);
+    return size;
 }
 
 /* Reads SIZE bytes from the file open as FD into buffer. Returns
@@ -427,26 +795,38 @@ static int filesize(int fd)
     the file could not be read (due to a condition other than end
     of file).
 
-    Fd 0 reads from the keyboard using input_getc(). */
+    Fd 0 reads from the keyboard, and stops early if the process is
+    being terminated. */
 static int read(int fd, void *buffer, unsigned size)
 {
     USER_ASSERT(is_user_mem(buffer, size));
-    USER_ASSERT(fd != STDOUT_FILENO);
 
-    if (fd == STDIN_FILENO)
+    int ret;
+    struct file *f = get_file_or_console(fd, STDIN_FILENO);
+
+#ifdef VM
+    if (!pin_user_mem(buffer, size, true))
     {
-        uint8_t *c = buffer;
-        for (unsigned i = 0; i != size; ++i)
-            *c++ = input_getc();
-        return size;
+        file_close(f);
+        exit(-1);
     }
+#endif
 
-    struct open_file *f = get_file_by_fd(fd);
+    if (f == NULL)
+    {
+        uint8_t *c = buffer;
+        for (ret = 0; ret != (int)size; ++ret)
+            if (!input_getc_cancellable(c + ret, process_exiting))
+                break;
+    }
+    else
+        ret = file_read(f, buffer, size);
 
-    lock_acquire(&file_lock);
-    int ret = file_read(f->file, buffer, size);
-    lock_release(&file_lock);
+#ifdef VM
+    unpin_user_mem(buffer, size);
+#endif
 
+    file_close(f);
     return ret;
 }
 
@@ -462,24 +842,20 @@ static int read(int fd, void *buffer, unsigned size)
     system and do not require any special effort in system call implementation. */
 static void seek(int fd, unsigned position)
 {
-    struct open_file *f = get_file_by_fd(fd);
-
-    lock_acquire(&file_lock);
-    file_seek(f->file, position);
-    lock_release(&file_lock);
+    struct file *f = get_file_by_fd(fd);
+    file_seek(f, position);
+    file_close(f);
 }
 
 /* Returns the position of the next byte to be read or written in open
     file FD, expressed in bytes from the beginning of the file. */
 static unsigned tell(int fd)
 {
-    struct open_file *f = get_file_by_fd(fd);
-
-    lock_acquire(&file_lock);
-    int ret = file_tell(f->file);
-    lock_release(&file_lock);
+    struct file *f = get_file_by_fd(fd);
+    unsigned position = file_tell(f);
 
-    return ret;
+    file_close(f);
+    return position;
 }
 
 /* Closes file descriptor FD. Exiting or terminating a process implicitly
@@ -487,12 +863,357 @@ static unsigned tell(int fd)
     for each one. */
 static void close(int fd)
 {
-    struct open_file *f = get_file_by_fd(fd);
+    struct file *f = process_remove_file(fd);
+    USER_ASSERT(f != NULL);
+
+    file_close(f);
+}
+
+/* Reads SIZE bytes from the file open as FD into BUFFER, starting
+    at byte OFFSET of the file, without changing the file's position.
+    Returns the number of bytes actually read, or -1 if FD is the
+    console or a pipe or OFFSET is out of range. */
+static int pread(int fd, void *buffer, unsigned size, unsigned offset)
+{
+    USER_ASSERT(is_user_mem(buffer, size));
+
+    if (is_console(fd) || (off_t)offset < 0)
+        return -1;
+
+    struct file *f = get_file_by_fd(fd);
+
+#ifdef VM
+    if (!pin_user_mem(buffer, size, true))
+    {
+        file_close(f);
+        exit(-1);
+    }
+#endif
+
+    int ret = file_read_at(f, buffer, size, offset);
+
+#ifdef VM
+    unpin_user_mem(buffer, size);
+#endif
+
+    file_close(f);
+    return ret;
+}
+
+/* Writes SIZE bytes from BUFFER to the file open as FD, starting
+    at byte OFFSET of the file, without changing the file's position.
+    Returns the number of bytes actually written, or -1 if FD is the
+    console or a pipe or OFFSET is out of range. */
+static int pwrite(int fd, const void *buffer, unsigned size, unsigned offset)
+{
+    USER_ASSERT(is_user_mem(buffer, size));
+
+    if (is_console(fd) || (off_t)offset < 0)
+        return -1;
+
+    struct file *f = get_file_by_fd(fd);
+
+#ifdef VM
+    if (!pin_user_mem(buffer, size, false))
+    {
+        file_close(f);
+        exit(-1);
+    }
+#endif
+
+    int ret = file_write_at(f, buffer, size, offset);
+
+#ifdef VM
+    unpin_user_mem(buffer, size);
+#endif
+
+    file_close(f);
+    return ret;
+}
+
+/* Number of iovecs that readv() and writev() copy in at a time. */
+#define IOV_BATCH 16
+
+/* Reads from FD into the IOVCNT buffers described by IOV, filling
+    each buffer in turn, as if by one read() per buffer.  Stops early
+    at end of file or on an error.  Returns the total number of bytes
+    read, or -1 if IOVCNT is out of range or nothing could be read
+    before an error. */
+static int readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct iovec batch[IOV_BATCH];
+    int total = 0;
+
+    if (iovcnt < 0 || iovcnt > IOV_MAX)
+        return -1;
+
+    for (int i = 0; i < iovcnt; i += IOV_BATCH)
+    {
+        int n = iovcnt - i < IOV_BATCH ? iovcnt - i : IOV_BATCH;
+
+        USER_ASSERT(copy_from_user(batch, iov + i, n * sizeof *batch));
+        for (int j = 0; j < n; j++)
+        {
+            int cnt = read(fd, batch[j].iov_base, batch[j].iov_len);
+
+            if (cnt < 0)
+                return total > 0 ? total : -1;
+            total += cnt;
+            if ((unsigned)cnt < batch[j].iov_len)
+                return total;
+        }
+    }
+
+    return total;
+}
+
+/* Writes the IOVCNT buffers described by IOV to FD, in order, as
+    if by one write() per buffer.  Stops early if a write comes up
+    short or fails.  Returns the total number of bytes written, or -1
+    if IOVCNT is out of range or nothing could be written before an
+    error. */
+static int writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct iovec batch[IOV_BATCH];
+    int total = 0;
+
+    if (iovcnt < 0 || iovcnt > IOV_MAX)
+        return -1;
+
+    for (int i = 0; i < iovcnt; i += IOV_BATCH)
+    {
+        int n = iovcnt - i < IOV_BATCH ? iovcnt - i : IOV_BATCH;
+
+        USER_ASSERT(copy_from_user(batch, iov + i, n * sizeof *batch));
+        for (int j = 0; j < n; j++)
+        {
+            int cnt = write(fd, batch[j].iov_base, batch[j].iov_len);
+
+            if (cnt < 0)
+                return total > 0 ? total : -1;
+            total += cnt;
+            if ((unsigned)cnt < batch[j].iov_len)
+                return total;
+        }
+    }
+
+    return total;
+}
+
+/* Copies up to SIZE bytes from the file open as FD_IN to the file
+    or console open as FD_OUT, starting at each file's position and
+    advancing it.  The data goes through a kernel page and never
+    visits user memory.  Returns the number of bytes copied, which is
+    less than SIZE at end of file or if a write comes up short, or -1
+    if FD_IN is the console or otherwise cannot be read, or no memory
+    is available. */
+static int copy_file_range(int fd_in, int fd_out, unsigned size)
+{
+    if (is_console(fd_in))
+        return -1;
+
+    struct file *in = process_get_file(fd_in);
+    struct file *out = process_get_file(fd_out);
+    uint8_t *buffer;
+    unsigned total = 0;
+
+    if (in == NULL || (out == NULL && fd_out != STDOUT_FILENO))
+    {
+        file_close(in);
+        file_close(out);
+        exit(-1);
+    }
+
+    buffer = palloc_get_page(0);
+    if (buffer == NULL)
+    {
+        file_close(in);
+        file_close(out);
+        return -1;
+    }
+
+    while (total < size)
+    {
+        off_t chunk = PGSIZE;
+        if ((unsigned)chunk > size - total)
+            chunk = size - total;
+
+        off_t cnt = file_read(in, buffer, chunk);
+        if (cnt <= 0)
+        {
+            /* A pipe's write end cannot be read. */
+            if (cnt < 0 && total == 0)
+                total = -1;
+            break;
+        }
+
+        if (out == NULL)
+            putbuf((const char *)buffer, cnt);
+        else if (file_write(out, buffer, cnt) != cnt)
+            break;
+
+        total += cnt;
+        if (cnt < chunk)
+            break;
+    }
+
+    palloc_free_page(buffer);
+    file_close(in);
+    file_close(out);
+    return total;
+}
+
+/* Creates a pipe and opens its read end as FDS[0] and its write
+    end as FDS[1].  Data written to the write end is buffered in
+    the kernel until it is read from the read end.  Reads wait for
+    data and return 0 once every write end is closed; writes wait
+    for room.  Returns 0 if successful, -1 otherwise. */
+static int pipe(int *fds)
+{
+    struct file *read_end, *write_end;
+    int kfds[2];
+
+    if (!pipe_open(&read_end, &write_end))
+        return -1;
+
+    kfds[0] = process_add_file(read_end);
+    kfds[1] = kfds[0] == -1 ? -1 : process_add_file(write_end);
+    if (kfds[1] == -1)
+    {
+        if (kfds[0] != -1)
+            process_remove_file(kfds[0]);
+        file_close(read_end);
+        file_close(write_end);
+        return -1;
+    }
+
+    /* Both ends are closed by exit() if FDS is bad. */
+    USER_ASSERT(copy_to_user(fds, kfds, sizeof kfds));
+    return 0;
+}
+
+/* Starts a new thread in the process, which runs the user code at
+    EIP as if it were a function called with arguments ARG0 and
+    ARG1 from a null return address.  The thread shares the
+    process's memory and file descriptors, and gets a stack of its
+    own of USER_THREAD_STACK_PAGES pages.  Returns the new thread's
+    id, or -1 if it cannot be created. */
+static tid_t create_thread(void *eip, void *arg0, void *arg1)
+{
+    return process_thread_create(eip, arg0, arg1);
+}
+
+/* Waits for thread TID of the process to exit.  Each thread can be
+    joined once.  Returns 0 once TID has exited, or -1 if TID is not
+    a thread created by thread_create in this process or has already
+    been joined. */
+static int join_thread(tid_t tid)
+{
+    return process_thread_join(tid);
+}
+
+/* Exits the current thread.  If it is the process's initial thread,
+    the process exits with status 0 once its other threads have
+    exited, unless one of them calls exit first. */
+static void exit_thread(void)
+{
+    process_thread_exit();
+}
+
+/* Sleeps until another thread of the process calls futex_wake on
+    UADDR, if the int at UADDR holds VAL.  The check and going to
+    sleep happen atomically with respect to futex_wake.  Returns
+    true after being woken, false at once if *UADDR != VAL. */
+static bool futex_wait(const int *uaddr, int val)
+{
+    USER_ASSERT(is_user_mem(uaddr, sizeof *uaddr));
+    return futex_sleep(uaddr, val);
+}
+
+/* Wakes up to CNT threads of the process sleeping in futex_wait on
+    UADDR, longest sleeping first.  Returns the number woken. */
+static int futex_wake(const int *uaddr, int cnt)
+{
+    return futex_wakeup(uaddr, cnt);
+}
+
+#ifdef VM
+/* Maps the file open as FD into the process's virtual address
+    space, starting at ADDR, and returns a mapping ID that uniquely
+    identifies the mapping within the process.  Returns -1 on
+    failure: if the file has a length of zero, if ADDR is not
+    page-aligned or is 0, or if the range of pages mapped overlaps
+    any existing set of mapped pages, including the stack or pages
+    mapped at executable load time.
+
+    Pages are loaded lazily on page fault.  The part of the final
+    page that lies beyond end of file reads as zeros and is not
+    written back. */
+static mapid_t mmap(int fd, void *addr)
+{
+    struct file *f = get_file_by_fd(fd);
+    mapid_t mapid = mmap_map(f, addr);
 
-    lock_acquire(&file_lock);
-    file_close(f->file);
-    lock_release(&file_lock);
+    file_close(f);
+    return mapid;
+}
+
+/* Unmaps the mapping designated by MAPPING, which must be a mapping
+    ID returned by a previous call to mmap by the same process that
+    has not yet been unmapped.  Only the pages that were modified are
+    written back to the file.  All mappings are implicitly unmapped
+    when a process exits. */
+static void munmap(mapid_t mapping)
+{
+    USER_ASSERT(mmap_unmap(mapping));
+}
+
+/* Returns the identifier of the shared memory segment named NAME.
+    If there is no such segment and SIZE is nonzero, creates one of
+    SIZE bytes, rounded up to whole pages, filled with zeros.
+    Returns -1 if the segment does not exist and cannot be created,
+    for instance because the segments together would hold more than
+    SHM_TOTAL_PAGE_MAX pages, or if it is smaller than SIZE.  A segment lasts until it is
+    unlinked and no process has it attached. */
+static int shm_open(const char *name, unsigned size)
+{
+    char *kname = copy_in_string(name);
+    if (kname == NULL)
+        return -1;
+
+    int shmid = shm_get(kname, size);
+    palloc_free_page(kname);
+    return shmid;
+}
+
+/* Attaches the shared memory segment SHMID at ADDR in the process's
+    virtual address space.  Every process that attaches a segment
+    sees the same memory.  Fails under the same conditions as mmap,
+    or if there is no segment SHMID.  Segments are implicitly
+    detached when a process exits. */
+static bool shm_attach(int shmid, void *addr)
+{
+    return shm_map(shmid, addr);
+}
+
+/* Detaches the shared memory segment attached at ADDR.  Returns
+    false if no segment is attached there. */
+static bool shm_detach(void *addr)
+{
+    return shm_unmap(addr);
+}
+
+/* Removes the name of the shared memory segment NAME.  Processes
+    that have it attached keep it until they detach it.  Returns
+    false if there is no segment named NAME. */
+static bool shm_unlink(const char *name)
+{
+    char *kname = copy_in_string(name);
+    if (kname == NULL)
+        return false;
 
-    list_remove(&f->elem);
-    free(f);
+    bool ok = shm_remove(kname);
+    palloc_free_page(kname);
+    return ok;
 }
+#endif
@@ -0,0 +1,92 @@
+#include "userprog/uaccess.h"
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Routines in usercopy.S. */
+size_t uaccess_copy(void *dst, const void *src, size_t size);
+int uaccess_strncpy(char *dst, const char *src, size_t size);
+
+/* Instructions in usercopy.S that may fault on user memory, and
+   where to resume if they do. */
+extern const char uaccess_copy_insn[], uaccess_copy_fixup[];
+extern const char uaccess_strncpy_insn[], uaccess_strncpy_fixup[];
+
+/* An entry in the fault fixup table. */
+struct fixup
+{
+    const void *insn;  /* Faulting instruction. */
+    const void *fixup; /* Where to resume. */
+};
+
+static const struct fixup fixups[] = {
+    {uaccess_copy_insn, uaccess_copy_fixup},
+    {uaccess_strncpy_insn, uaccess_strncpy_fixup},
+};
+
+/* Returns the number of bytes from UADDR to the top of user
+   memory, or 0 if UADDR is not a user address. */
+static size_t user_bytes_above(const void *uaddr)
+{
+    return is_user_vaddr(uaddr) ? (size_t)((uint8_t *)PHYS_BASE - (uint8_t *)uaddr) : 0;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address DST.
+   Returns true if successful, false if any byte of the source is
+   not mapped or not in user memory. */
+bool copy_from_user(void *dst, const void *usrc, size_t size)
+{
+    if (size == 0)
+        return true;
+    if (size > user_bytes_above(usrc))
+        return false;
+    return uaccess_copy(dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address UDST.
+   Returns true if successful, false if any byte of the
+   destination is not writable user memory. */
+bool copy_to_user(void *udst, const void *src, size_t size)
+{
+    if (size == 0)
+        return true;
+    if (size > user_bytes_above(udst))
+        return false;
+    return uaccess_copy(udst, src, size) == 0;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes.  Returns the length of the
+   string, not counting its null terminator, or -1 if it is not
+   valid user memory or does not fit in SIZE bytes. */
+int strncpy_from_user(char *dst, const char *usrc, size_t size)
+{
+    size_t limit = user_bytes_above(usrc);
+    int len;
+
+    if (limit > size)
+        limit = size;
+    if (limit == 0)
+        return -1;
+
+    len = uaccess_strncpy(dst, usrc, limit);
+    return (size_t)len < limit ? len : -1;
+}
+
+/* Called by the page fault handler for faults in kernel mode.
+   If F faulted while accessing user memory on behalf of one of
+   the functions above, arranges for it to return failure and
+   returns true.  Otherwise, returns false. */
+bool uaccess_fixup(struct intr_frame *f)
+{
+    for (size_t i = 0; i < sizeof fixups / sizeof *fixups; i++)
+    {
+        if ((const void *)f->eip == fixups[i].insn)
+        {
+            f->eip = (void (*)(void))fixups[i].fixup;
+            return true;
+        }
+    }
+
+    return false;
+}
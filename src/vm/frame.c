@@ -0,0 +1,295 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include "vm/page.h"
+#include "vm/wset.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+
+/* Frame table.  Every page of the user pool is taken from palloc
+   at boot and handed out from here. */
+static struct frame *frames;
+static size_t frame_cnt;
+
+/* Number of frames not holding any page. */
+static size_t free_cnt;
+
+/* Protects the search for a free frame and the clock hand. */
+static struct lock scan_lock;
+
+/* Clock hand, index of the next eviction candidate. */
+static size_t hand;
+
+/* The page-out daemon starts evicting when fewer than low_water
+   frames are free, and stops once high_water frames are free,
+   so that faults rarely have to write a page out themselves. */
+static size_t low_water, high_water;
+static struct semaphore pageout_sema; /* Upped to wake the daemon. */
+static bool pageout_started;          /* Daemon running? */
+static bool pageout_pending;          /* pageout_sema already upped? */
+
+static bool evict(struct frame *);
+static thread_func pageout_daemon;
+
+/* Initializes the frame table by claiming the whole user pool. */
+void frame_init(void)
+{
+    void *kpage;
+
+    lock_init(&scan_lock);
+    sema_init(&pageout_sema, 0);
+
+    frames = malloc(sizeof *frames * init_ram_pages);
+    if (frames == NULL)
+        PANIC("out of memory allocating frame table");
+
+    while ((kpage = palloc_get_page(PAL_USER)) != NULL)
+    {
+        struct frame *f = &frames[frame_cnt++];
+        lock_init(&f->lock);
+        f->kpage = kpage;
+        f->page = NULL;
+    }
+    free_cnt = frame_cnt;
+    low_water = frame_cnt / 32 + 1;
+    high_water = low_water * 2;
+}
+
+/* Starts the page-out daemon.  Must be called after swap_init(). */
+void frame_pageout_start(void)
+{
+    pageout_started = true;
+    thread_create("pageout", PRI_DEFAULT, pageout_daemon, NULL);
+}
+
+/* Returns the number of frames not holding any page. */
+size_t frame_free_cnt(void)
+{
+    return free_cnt;
+}
+
+/* Tries to lock F without blocking.  Fails on frames that the
+   current thread has already locked, such as pinned buffers. */
+static bool try_lock(struct frame *f)
+{
+    return !lock_held_by_current_thread(&f->lock) && lock_try_acquire(&f->lock);
+}
+
+/* Adds DELTA to free_cnt, waking the page-out daemon if free
+   frames are running low. */
+static void adjust_free_cnt(int delta)
+{
+    enum intr_level old_level = intr_disable();
+    free_cnt += delta;
+    if (free_cnt < low_water && pageout_started && !pageout_pending)
+    {
+        pageout_pending = true;
+        sema_up(&pageout_sema);
+    }
+    intr_set_level(old_level);
+}
+
+/* Hands free frame F, which must be locked, to PAGE. */
+static void claim_free(struct frame *f, struct page *page)
+{
+    adjust_free_cnt(-1);
+    f->page = page;
+    wset_charge(page);
+}
+
+/* Tries to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+static struct frame *try_frame_alloc_and_lock(struct page *page)
+{
+    size_t i;
+
+    lock_acquire(&scan_lock);
+
+    /* Find a free frame. */
+    for (i = 0; i < frame_cnt; i++)
+    {
+        struct frame *f = &frames[i];
+        if (!try_lock(f))
+            continue;
+        if (f->page == NULL)
+        {
+            claim_free(f, page);
+            lock_release(&scan_lock);
+            return f;
+        }
+        lock_release(&f->lock);
+    }
+
+    /* No free frame.  Find a frame to evict.
+       Two turns of the clock hand are enough to clear every
+       accessed bit at least once.  Pages of a process suspended
+       by load control go first, used or not. */
+    for (i = 0; i < frame_cnt * 2; i++)
+    {
+        struct frame *f = &frames[hand];
+        if (++hand >= frame_cnt)
+            hand = 0;
+
+        if (!try_lock(f))
+            continue;
+
+        if (f->page == NULL)
+        {
+            claim_free(f, page);
+            lock_release(&scan_lock);
+            return f;
+        }
+
+        if (!wset_suspended(f->page) && page_accessed_recently(f->page))
+        {
+            lock_release(&f->lock);
+            continue;
+        }
+
+        lock_release(&scan_lock);
+
+        /* Evict this frame. */
+        if (!evict(f))
+        {
+            lock_release(&f->lock);
+            return NULL;
+        }
+
+        claim_free(f, page);
+        return f;
+    }
+
+    lock_release(&scan_lock);
+    return NULL;
+}
+
+/* Tries really hard to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+struct frame *frame_alloc_and_lock(struct page *page)
+{
+    for (int try = 0; try < 3; try++)
+    {
+        struct frame *f = try_frame_alloc_and_lock(page);
+        if (f != NULL)
+        {
+            ASSERT(lock_held_by_current_thread(&f->lock));
+            return f;
+        }
+        timer_msleep(1000);
+    }
+
+    return NULL;
+}
+
+/* Locks P's frame into memory, if it has one.
+   Upon return, p->frame will not change until P is unlocked. */
+void frame_lock(struct page *p)
+{
+    /* A frame can be asynchronously removed, but never inserted. */
+    struct frame *f = p->frame;
+    if (f != NULL)
+    {
+        lock_acquire(&f->lock);
+        if (f != p->frame)
+        {
+            lock_release(&f->lock);
+            ASSERT(p->frame == NULL);
+        }
+    }
+}
+
+/* Unlocks frame F, allowing it to be evicted.
+   F must be locked for use by the current process. */
+void frame_unlock(struct frame *f)
+{
+    ASSERT(lock_held_by_current_thread(&f->lock));
+    lock_release(&f->lock);
+}
+
+/* Releases frame F for use by another page.
+   F must be locked for use by the current process.
+   Any data in F is lost. */
+void frame_free(struct frame *f)
+{
+    ASSERT(lock_held_by_current_thread(&f->lock));
+
+    wset_uncharge(f->page, false);
+    f->page = NULL;
+    adjust_free_cnt(1);
+    lock_release(&f->lock);
+}
+
+/* Writes out the page in locked frame F and frees F.
+   Returns true if successful, false if the page could not be
+   written out, in which case F keeps its page. */
+static bool evict(struct frame *f)
+{
+    if (!page_out(f->page))
+        return false;
+
+    wset_uncharge(f->page, true);
+    f->page = NULL;
+    adjust_free_cnt(1);
+    return true;
+}
+
+/* Evicts every resident page of thread T that has not been
+   accessed since its accessed bit was last sampled, skipping
+   pages that are locked.  Returns the number of pages evicted. */
+size_t frame_trim(struct thread *t)
+{
+    size_t evicted = 0;
+
+    for (size_t i = 0; i < frame_cnt; i++)
+    {
+        struct frame *f = &frames[i];
+        if (!try_lock(f))
+            continue;
+
+        if (f->page != NULL && f->page->thread == t
+            && !page_accessed_recently(f->page) && evict(f))
+            evicted++;
+        lock_release(&f->lock);
+    }
+
+    return evicted;
+}
+
+/* Page-out daemon.  Whenever free frames drop below low_water,
+   follows the clock hand and evicts pages that have not been
+   accessed recently, writing dirty ones to swap or their files,
+   until high_water frames are free or two turns of the hand
+   find nothing more to take. */
+static void pageout_daemon(void *aux UNUSED)
+{
+    for (;;)
+    {
+        sema_down(&pageout_sema);
+        pageout_pending = false;
+
+        for (size_t i = 0; i < frame_cnt * 2 && free_cnt < high_water; i++)
+        {
+            struct frame *f;
+
+            lock_acquire(&scan_lock);
+            f = &frames[hand];
+            if (++hand >= frame_cnt)
+                hand = 0;
+            if (!try_lock(f))
+            {
+                lock_release(&scan_lock);
+                continue;
+            }
+            lock_release(&scan_lock);
+
+            if (f->page != NULL
+                && (wset_suspended(f->page) || !page_accessed_recently(f->page)))
+                evict(f);
+            lock_release(&f->lock);
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+struct page;
+struct thread;
+
+/* A physical frame of user memory. */
+struct frame
+{
+    struct lock lock;  /* Held while the frame is being used for I/O. */
+    void *kpage;       /* Kernel virtual base address. */
+    struct page *page; /* Mapped page, if any. */
+};
+
+void frame_init(void);
+void frame_pageout_start(void);
+struct frame *frame_alloc_and_lock(struct page *);
+void frame_lock(struct page *);
+void frame_unlock(struct frame *);
+void frame_free(struct frame *);
+size_t frame_free_cnt(void);
+size_t frame_trim(struct thread *);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,136 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include "vm/page.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+
+/* A memory-mapped file. */
+struct mapping
+{
+    mapid_t id;            /* Mapping identifier. */
+    struct file *file;     /* Private reopened file. */
+    uint8_t *base;         /* Start of the mapping. */
+    size_t page_cnt;       /* Number of pages mapped. */
+    struct list_elem elem; /* List element for process's mappings. */
+};
+
+static void unmap(struct mapping *);
+
+/* Maps FILE into the current process's address space starting at
+   ADDR.  Pages are loaded lazily on first access.  Returns the
+   new mapping's identifier, or MAP_FAILED if FILE is empty, ADDR
+   is null or not page-aligned, or the range overlaps an existing
+   mapping of any kind. */
+mapid_t mmap_map(struct file *file, void *addr)
+{
+    struct process *self = thread_current()->process;
+    struct mapping *m;
+    off_t length = 0;
+    size_t i;
+
+    if (addr == NULL || pg_ofs(addr) != 0)
+        return MAP_FAILED;
+
+    m = malloc(sizeof *m);
+    if (m == NULL)
+        return MAP_FAILED;
+
+    m->file = file_reopen(file);
+    if (m->file != NULL)
+        length = file_length(m->file);
+
+    lock_acquire(&self->mm_lock);
+    if (m->file == NULL || length == 0)
+        goto fail;
+
+    m->base = addr;
+    m->page_cnt = DIV_ROUND_UP(length, PGSIZE);
+
+    /* The whole range must be unused user memory outside the
+       region reserved for stack growth. */
+    for (i = 0; i < m->page_cnt; i++)
+    {
+        void *upage = m->base + i * PGSIZE;
+        if (upage >= page_stack_bottom() || page_for_addr(upage) != NULL)
+            goto fail;
+    }
+
+    for (i = 0; i < m->page_cnt; i++)
+    {
+        off_t ofs = i * PGSIZE;
+        struct page *p = page_allocate(m->base + ofs, true);
+        if (p == NULL)
+        {
+            while (i-- > 0)
+                page_deallocate(m->base + i * PGSIZE);
+            goto fail;
+        }
+        p->private = false;
+        p->file = m->file;
+        p->file_ofs = ofs;
+        p->file_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+    }
+
+    m->id = self->mapid++;
+    list_push_back(&self->mappings, &m->elem);
+    lock_release(&self->mm_lock);
+    return m->id;
+
+fail:
+    lock_release(&self->mm_lock);
+    file_close(m->file);
+    free(m);
+    return MAP_FAILED;
+}
+
+/* Unmaps the mapping MAPID of the current process, writing back
+   the pages that were modified.  Returns false if there is no
+   such mapping. */
+bool mmap_unmap(mapid_t mapid)
+{
+    struct process *self = thread_current()->process;
+    struct list *l = &self->mappings;
+    bool found = false;
+
+    lock_acquire(&self->mm_lock);
+    for (struct list_elem *e = list_begin(l); e != list_end(l); e = list_next(e))
+    {
+        struct mapping *m = list_entry(e, struct mapping, elem);
+        if (m->id == mapid)
+        {
+            unmap(m);
+            found = true;
+            break;
+        }
+    }
+    lock_release(&self->mm_lock);
+
+    return found;
+}
+
+/* Unmaps all of the current process's mappings.  No other thread
+   of the process may be left. */
+void mmap_exit(void)
+{
+    struct list *l = &thread_current()->process->mappings;
+
+    while (!list_empty(l))
+        unmap(list_entry(list_front(l), struct mapping, elem));
+}
+
+/* Writes back and removes mapping M. */
+static void unmap(struct mapping *m)
+{
+    list_remove(&m->elem);
+
+    for (size_t i = 0; i < m->page_cnt; i++)
+        page_deallocate(m->base + i * PGSIZE);
+
+    file_close(m->file);
+    free(m);
+}
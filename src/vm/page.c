@@ -0,0 +1,540 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/wset.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+
+size_t stack_page_limit = STACK_PAGE_LIMIT_DEFAULT;
+
+/* A page of zeros, mapped read-only for zero-fill pages that
+   have been read but not yet written.  Never freed. */
+static void *zero_page;
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func destroy_page;
+static struct page *find_page(const void *addr);
+static void unmap_zero_page(struct page *);
+
+/* Initializes the shared zero page. */
+void page_init(void)
+{
+    zero_page = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+}
+
+/* Creates an empty supplemental page table for T.
+   Returns true if successful, false if memory allocation fails. */
+bool page_table_create(struct thread *t)
+{
+    t->pages = malloc(sizeof *t->pages);
+    if (t->pages == NULL)
+        return false;
+
+    if (!hash_init(&t->pages->pages, page_hash, page_less, NULL))
+    {
+        free(t->pages);
+        t->pages = NULL;
+        return false;
+    }
+    lock_init(&t->pages->lock);
+    return true;
+}
+
+/* Destroys T's supplemental page table, releasing every frame
+   and swap slot it still holds.  Must be called while T's page
+   directory is still alive, and after all file mappings have
+   been written back. */
+void page_table_destroy(struct thread *t)
+{
+    if (t->pages == NULL)
+        return;
+
+    hash_destroy(&t->pages->pages, destroy_page);
+    free(t->pages);
+    t->pages = NULL;
+}
+
+/* Destroys the page in hash element E. */
+static void destroy_page(struct hash_elem *e, void *aux UNUSED)
+{
+    struct page *p = hash_entry(e, struct page, elem);
+
+    if (p->shm_kpage != NULL)
+        pagedir_clear_page(p->thread->pagedir, p->upage);
+    unmap_zero_page(p);
+    frame_lock(p);
+    if (p->frame != NULL)
+    {
+        pagedir_clear_page(p->thread->pagedir, p->upage);
+        frame_free(p->frame);
+    }
+    if (p->swap_slot != SWAP_SLOT_NONE)
+        swap_free(p->swap_slot);
+    free(p);
+}
+
+/* Adds a zero page at UPAGE to the current thread's page table,
+   whose lock must be held.  Returns the new page, or a null
+   pointer if UPAGE is already mapped or memory allocation
+   fails. */
+static struct page *insert_page(void *upage, bool writable)
+{
+    struct thread *t = thread_current();
+    struct page *p = malloc(sizeof *p);
+    if (p == NULL)
+        return NULL;
+
+    p->upage = pg_round_down(upage);
+    p->writable = writable;
+    p->thread = t->process->thread;
+    p->frame = NULL;
+    p->zero_mapped = false;
+    p->swap_slot = SWAP_SLOT_NONE;
+    p->private = true;
+    p->file = NULL;
+    p->file_ofs = 0;
+    p->file_bytes = 0;
+    p->shm_kpage = NULL;
+
+    if (hash_insert(&t->pages->pages, &p->elem) != NULL)
+    {
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+/* Adds a mapping for user virtual address UPAGE to the current
+   thread's page table.  The page starts out as all zeros; the
+   caller may set up file backing before it is first touched.
+   Returns the new page, or a null pointer if UPAGE is already
+   mapped or memory allocation fails. */
+struct page *page_allocate(void *upage, bool writable)
+{
+    struct page_table *pt = thread_current()->pages;
+    struct page *p;
+
+    lock_acquire(&pt->lock);
+    p = insert_page(upage, writable);
+    lock_release(&pt->lock);
+    return p;
+}
+
+/* Evicts the page containing UPAGE, writing it back to its file
+   if it is a dirty shared mapping, and removes it from the
+   current thread's page table. */
+void page_deallocate(void *upage)
+{
+    struct page_table *pt = thread_current()->pages;
+    struct page *p;
+
+    /* Once out of the table, no other thread can reach P. */
+    lock_acquire(&pt->lock);
+    p = find_page(upage);
+    ASSERT(p != NULL);
+    hash_delete(&pt->pages, &p->elem);
+    lock_release(&pt->lock);
+
+    if (p->shm_kpage != NULL)
+        pagedir_clear_page(p->thread->pagedir, p->upage);
+    unmap_zero_page(p);
+    frame_lock(p);
+    if (p->frame != NULL)
+    {
+        struct frame *f = p->frame;
+        if (p->file != NULL && !p->private)
+            page_out(p);
+        else
+            pagedir_clear_page(p->thread->pagedir, p->upage);
+        frame_free(f);
+    }
+    if (p->swap_slot != SWAP_SLOT_NONE)
+        swap_free(p->swap_slot);
+    free(p);
+}
+
+/* Returns the lowest address that the user stack may grow down
+   to, which is stack_page_limit pages below PHYS_BASE. */
+void *page_stack_bottom(void)
+{
+    size_t max_pages = (uintptr_t)PHYS_BASE / PGSIZE - 1;
+    size_t pages = stack_page_limit < max_pages ? stack_page_limit : max_pages;
+
+    return (uint8_t *)PHYS_BASE - pages * PGSIZE;
+}
+
+/* Returns true if an access to ADDR looks like a push onto the
+   current thread's user stack.  PUSH faults 4 bytes and PUSHA 32
+   bytes below the stack pointer, before it is decremented. */
+static bool is_stack_access(const void *addr)
+{
+    const uint8_t *esp = thread_current()->user_esp;
+
+    return addr >= page_stack_bottom() && (const uint8_t *)addr >= esp - 32;
+}
+
+/* Returns the page containing ADDR in the current thread's page
+   table, whose lock must be held, or a null pointer if there is
+   no such page. */
+static struct page *find_page(const void *addr)
+{
+    struct page p;
+    struct hash_elem *e;
+
+    if (!is_user_vaddr(addr))
+        return NULL;
+
+    p.upage = pg_round_down(addr);
+    e = hash_find(&thread_current()->pages->pages, &p.elem);
+    return e != NULL ? hash_entry(e, struct page, elem) : NULL;
+}
+
+/* If ADDR, which is not yet mapped, is an access just below the
+   user stack pointer, grows the stack by adding a zero page for
+   it, up to the stack limit.  Returns the new page, or a null
+   pointer if ADDR is not a stack access.  The page table's lock
+   must be held. */
+static struct page *grow_stack(const void *addr)
+{
+    if (!is_user_vaddr(addr) || !is_stack_access(addr))
+        return NULL;
+    return insert_page((void *)addr, true);
+}
+
+/* Like page_for_addr(), but the page table's lock must be held. */
+static struct page *lookup_page(const void *addr)
+{
+    struct page *p = find_page(addr);
+
+    return p != NULL ? p : grow_stack(addr);
+}
+
+/* Returns the page containing ADDR in the current thread's page
+   table, or a null pointer if there is no such page.
+   If ADDR is an access just below the user stack pointer, grows
+   the stack by adding a zero page for it, up to the stack limit. */
+struct page *page_for_addr(const void *addr)
+{
+    struct page_table *pt = thread_current()->pages;
+    struct page *p;
+
+    if (pt == NULL)
+        return NULL;
+
+    lock_acquire(&pt->lock);
+    p = lookup_page(addr);
+    lock_release(&pt->lock);
+    return p;
+}
+
+/* Locks a frame for page P and brings the page's contents into
+   it.  Returns true if successful, false on failure. */
+static bool do_page_in(struct page *p)
+{
+    p->frame = frame_alloc_and_lock(p);
+    if (p->frame == NULL)
+        return false;
+
+    if (p->swap_slot != SWAP_SLOT_NONE)
+    {
+        swap_in(p->swap_slot, p->frame->kpage);
+        p->swap_slot = SWAP_SLOT_NONE;
+    }
+    else if (p->file != NULL)
+    {
+        off_t read_bytes = file_read_at(p->file, p->frame->kpage,
+                                        p->file_bytes, p->file_ofs);
+
+        if (read_bytes != p->file_bytes)
+        {
+            struct frame *f = p->frame;
+            p->frame = NULL;
+            frame_free(f);
+            return false;
+        }
+        memset((uint8_t *)p->frame->kpage + read_bytes, 0, PGSIZE - read_bytes);
+    }
+    else
+        memset(p->frame->kpage, 0, PGSIZE);
+
+    return true;
+}
+
+/* Removes P's mapping to the shared zero page, if any, so that
+   no stale read-only translation survives in the TLB. */
+static void unmap_zero_page(struct page *p)
+{
+    if (p->zero_mapped)
+    {
+        pagedir_clear_page(p->thread->pagedir, p->upage);
+        p->zero_mapped = false;
+    }
+}
+
+/* Maps P's frame into its owner's page directory.
+   Returns true if successful, false if memory allocation fails. */
+static bool install_page(struct page *p)
+{
+    uint32_t *pd = p->thread->pagedir;
+
+    unmap_zero_page(p);
+    if (!pagedir_set_page(pd, p->upage, p->frame->kpage, p->writable))
+        return false;
+
+    /* Give the freshly loaded page a full turn of the clock. */
+    pagedir_set_accessed(pd, p->upage, true);
+    return true;
+}
+
+/* Does the work of page_in() with the page table's lock held.
+   If the page is already resident, sets *RESIDENT to its frame
+   and returns FAULT_MINOR. */
+static enum fault_type fault_in(void *fault_addr, bool write,
+                                struct frame **resident)
+{
+    struct page *p = find_page(fault_addr);
+    enum fault_type type = FAULT_INVALID;
+    bool success;
+
+    if (p == NULL)
+    {
+        p = grow_stack(fault_addr);
+        type = FAULT_STACK;
+    }
+    if (p == NULL || (write && !p->writable))
+        return FAULT_INVALID;
+
+    /* Shared memory stays mapped while it is attached, so there is
+       nothing to bring in. */
+    if (p->shm_kpage != NULL)
+        return FAULT_INVALID;
+
+    /* A frame can be asynchronously removed, but only inserted
+       with the page table locked. */
+    if (p->frame != NULL)
+    {
+        *resident = p->frame;
+        return FAULT_MINOR;
+    }
+
+    /* Fast path: reading a page that has never held any data
+       needs no frame of its own, and never blocks. */
+    if (!write && p->file == NULL && p->swap_slot == SWAP_SLOT_NONE)
+    {
+        p->zero_mapped = pagedir_set_page(p->thread->pagedir, p->upage,
+                                          zero_page, false);
+        if (!p->zero_mapped)
+            return FAULT_INVALID;
+        return type == FAULT_STACK ? FAULT_STACK : FAULT_ZERO_MAP;
+    }
+
+    if (type != FAULT_STACK)
+    {
+        if (p->zero_mapped)
+            type = FAULT_COW;
+        else if (p->swap_slot != SWAP_SLOT_NONE)
+            type = FAULT_SWAP;
+        else if (p->file != NULL)
+            type = FAULT_FILE;
+        else
+            type = FAULT_ZERO_FILL;
+    }
+
+    wset_fault();
+    if (!do_page_in(p))
+        return FAULT_INVALID;
+    ASSERT(lock_held_by_current_thread(&p->frame->lock));
+
+    success = install_page(p);
+    frame_unlock(p->frame);
+    return success ? type : FAULT_INVALID;
+}
+
+/* Faults in the page containing FAULT_ADDR, for writing if WRITE
+   is true.  Returns the kind of fault, which is FAULT_INVALID if
+   the access is not allowed or the page could not be brought
+   in. */
+enum fault_type page_in(void *fault_addr, bool write)
+{
+    struct page_table *pt = thread_current()->pages;
+    struct frame *resident = NULL;
+    enum fault_type type;
+
+    if (pt == NULL)
+        return FAULT_INVALID;
+
+    lock_acquire(&pt->lock);
+    type = fault_in(fault_addr, write, &resident);
+    lock_release(&pt->lock);
+
+    /* Another thread of the process may have just brought the page
+       in, or the page may be on its way out.  Either way, wait
+       until its frame is free before the access is retried. */
+    if (resident != NULL)
+    {
+        lock_acquire(&resident->lock);
+        lock_release(&resident->lock);
+    }
+    return type;
+}
+
+/* Writes page P to its backing store, if necessary, and
+   unmaps it from its owner's page directory.
+   P must have a locked frame.
+   Returns true if successful, false on failure. */
+bool page_out(struct page *p)
+{
+    uint32_t *pd = p->thread->pagedir;
+    bool dirty;
+    bool ok = false;
+
+    ASSERT(p->frame != NULL);
+    ASSERT(lock_held_by_current_thread(&p->frame->lock));
+
+    /* Mark page not present in page table, forcing accesses by the
+       process to fault.  This must happen before checking the
+       dirty bit, to prevent a race with the process dirtying the
+       page. */
+    pagedir_clear_page(pd, p->upage);
+
+    dirty = pagedir_is_dirty(pd, p->upage);
+
+    if (p->file != NULL && !dirty)
+        ok = true;
+    else if (p->file != NULL && !p->private)
+        ok = file_write_at(p->file, p->frame->kpage, p->file_bytes,
+                           p->file_ofs) == p->file_bytes;
+    else
+    {
+        p->swap_slot = swap_out(p->frame->kpage);
+        if (p->swap_slot != SWAP_SLOT_NONE)
+        {
+            /* The page no longer matches its file, so it is
+               anonymous from now on. */
+            p->file = NULL;
+            p->file_ofs = 0;
+            p->file_bytes = 0;
+            ok = true;
+        }
+    }
+
+    if (ok)
+        p->frame = NULL;
+    return ok;
+}
+
+/* Returns true if page P's data has been accessed recently,
+   false otherwise.  Clears the accessed bit as a side effect.
+   P must have a locked frame. */
+bool page_accessed_recently(struct page *p)
+{
+    uint32_t *pd = p->thread->pagedir;
+    bool accessed;
+
+    ASSERT(p->frame != NULL);
+    ASSERT(lock_held_by_current_thread(&p->frame->lock));
+
+    accessed = pagedir_is_accessed(pd, p->upage);
+    if (accessed)
+        pagedir_set_accessed(pd, p->upage, false);
+    return accessed;
+}
+
+/* Pins the page containing ADDR into memory, faulting it in if
+   necessary, so that the kernel can touch it without faulting.
+   If WILL_WRITE is true, the page must be writable.
+   Returns true if successful, false on failure. */
+bool page_lock(const void *addr, bool will_write)
+{
+    struct page_table *pt = thread_current()->pages;
+
+    if (pt == NULL)
+        return false;
+
+    for (;;)
+    {
+        struct page *p;
+        struct frame *f;
+        bool success;
+
+        lock_acquire(&pt->lock);
+        p = lookup_page(addr);
+        if (p == NULL || (!p->writable && will_write))
+        {
+            lock_release(&pt->lock);
+            return false;
+        }
+        if (p->shm_kpage != NULL)
+        {
+            lock_release(&pt->lock);
+            return true;
+        }
+
+        f = p->frame;
+        if (f == NULL)
+        {
+            success = do_page_in(p);
+            if (success && !install_page(p))
+            {
+                f = p->frame;
+                p->frame = NULL;
+                frame_free(f);
+                success = false;
+            }
+            lock_release(&pt->lock);
+            return success;
+        }
+
+        /* Lock the resident frame without holding the page table's
+           lock, then make sure that it still holds the page. */
+        lock_release(&pt->lock);
+        lock_acquire(&f->lock);
+        lock_acquire(&pt->lock);
+        p = find_page(addr);
+        success = p != NULL && p->frame == f;
+        lock_release(&pt->lock);
+        if (success)
+            return true;
+        lock_release(&f->lock);
+    }
+}
+
+/* Unpins the page containing ADDR, which must have been pinned
+   with page_lock(). */
+void page_unlock(const void *addr)
+{
+    struct page_table *pt = thread_current()->pages;
+    struct page *p;
+
+    lock_acquire(&pt->lock);
+    p = find_page(addr);
+    lock_release(&pt->lock);
+
+    ASSERT(p != NULL);
+    if (p->shm_kpage == NULL)
+        frame_unlock(p->frame);
+}
+
+/* Returns a hash value for the page that E refers to. */
+static unsigned page_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+    const struct page *p = hash_entry(e, struct page, elem);
+    return hash_int((uintptr_t)p->upage >> PGBITS);
+}
+
+/* Returns true if page A precedes page B. */
+static bool page_less(const struct hash_elem *a_, const struct hash_elem *b_,
+                      void *aux UNUSED)
+{
+    const struct page *a = hash_entry(a_, struct page, elem);
+    const struct page *b = hash_entry(b_, struct page, elem);
+
+    return a->upage < b->upage;
+}
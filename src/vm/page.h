@@ -0,0 +1,100 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+#include "vm/swap.h"
+
+struct file;
+struct thread;
+
+/* Default maximum size of a user stack, in pages (8 MB). */
+#define STACK_PAGE_LIMIT_DEFAULT 2048
+
+/* Maximum size of a user stack, in pages.
+   Controlled by kernel command-line option "-sl=COUNT". */
+extern size_t stack_page_limit;
+
+/* Kinds of page fault, as classified by page_in(). */
+enum fault_type
+{
+    FAULT_ZERO_MAP,  /* Read of a zero page, mapped to the zero page. */
+    FAULT_ZERO_FILL, /* Zero page given a frame of its own. */
+    FAULT_FILE,      /* Page read in from its file. */
+    FAULT_SWAP,      /* Page read in from swap. */
+    FAULT_COW,       /* First write to a page mapped to the zero page. */
+    FAULT_STACK,     /* New stack page. */
+    FAULT_MINOR,     /* Page was already resident. */
+    FAULT_INVALID,   /* Not a valid access. */
+    FAULT_TYPE_CNT   /* Number of fault types. */
+};
+
+/* Supplemental page table of a process, shared by all of its
+   threads.
+
+   LOCK protects PAGES, and is held while a page that is not
+   resident is brought in, so that two threads faulting on the
+   same page do not both load it.  A thread never waits for a
+   frame's lock while holding LOCK, since the holder of the frame
+   may be pinning user memory and need LOCK itself. */
+struct page_table
+{
+    struct hash pages; /* struct page, keyed by upage. */
+    struct lock lock;  /* Protects PAGES. */
+};
+
+/* A user virtual page, in the supplemental page table.
+
+   A page's contents come from, in order of precedence:
+   its frame if it is resident, its swap slot if it has been
+   swapped out, FILE if it is file-backed, or zeros otherwise.
+   A page of zeros that has only been read is mapped read-only to
+   a single zero page shared by all processes, and gets a frame of
+   its own on the first write.  A page of a shared memory segment
+   instead stays mapped to SHM_KPAGE, outside the frame table, for
+   as long as it exists. */
+struct page
+{
+    void *upage;           /* User virtual address. */
+    bool writable;         /* Writable by the user process? */
+    struct thread *thread; /* Initial thread of owning process. */
+    struct hash_elem elem; /* Element in page_table's `pages'. */
+
+    /* Set only while resident, protected by the frame's lock. */
+    struct frame *frame; /* Frame holding the page, or null. */
+
+    /* Protected by the page table's lock. */
+    bool zero_mapped; /* Mapped to the shared zero page? */
+
+    /* Swap information, protected by the frame's lock. */
+    swap_slot_t swap_slot; /* Swap slot, or SWAP_SLOT_NONE. */
+
+    /* File information, protected by the frame's lock. */
+    bool private;     /* False to write back to file, true to swap. */
+    struct file *file; /* Backing file, or null. */
+    off_t file_ofs;    /* Offset in file. */
+    off_t file_bytes;  /* Bytes to read from file, rest are zeros. */
+
+    /* Set only by vm/shm.c. */
+    void *shm_kpage; /* Shared memory page, or null. */
+};
+
+void page_init(void);
+bool page_table_create(struct thread *);
+void page_table_destroy(struct thread *);
+
+struct page *page_allocate(void *upage, bool writable);
+void page_deallocate(void *upage);
+struct page *page_for_addr(const void *addr);
+void *page_stack_bottom(void);
+
+enum fault_type page_in(void *fault_addr, bool write);
+bool page_out(struct page *);
+bool page_accessed_recently(struct page *);
+
+bool page_lock(const void *addr, bool will_write);
+void page_unlock(const void *addr);
+
+#endif /* vm/page.h */
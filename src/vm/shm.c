@@ -0,0 +1,310 @@
+#include "vm/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include "vm/page.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+
+/* A named segment of shared anonymous memory.
+
+   A segment's pages come from the kernel pool, so they are never
+   evicted and count against SHM_TOTAL_PAGE_MAX, and are mapped
+   directly into the page directory of
+   every process that attaches the segment.  The segment lives
+   until its name is unlinked and the last attachment goes away. */
+struct shm_segment
+{
+    int id;                      /* Segment identifier. */
+    char name[SHM_NAME_MAX + 1]; /* Name, for shm_get(). */
+    bool unlinked;               /* Name removed by shm_remove()? */
+    int attach_cnt;              /* Number of attachments. */
+    size_t page_cnt;             /* Number of pages. */
+    void **kpages;               /* Kernel addresses of the pages. */
+    struct list_elem elem;       /* Element in `segments'. */
+};
+
+/* A segment attached to a process. */
+struct shm_attachment
+{
+    struct shm_segment *seg; /* Attached segment. */
+    uint8_t *base;           /* Start of the attachment. */
+    struct list_elem elem;   /* Element in process's `shm_attachments'. */
+};
+
+/* All segments, the next segment identifier, and the number of
+   pages the segments hold.  Protected by shm_lock, as are the
+   segments' members. */
+static struct list segments;
+static int next_id;
+static size_t total_page_cnt;
+static struct lock shm_lock;
+
+static void release(struct shm_segment *);
+static void detach(struct shm_attachment *);
+
+/* Initializes the shared memory segment table. */
+void shm_init(void)
+{
+    list_init(&segments);
+    lock_init(&shm_lock);
+}
+
+/* Returns the segment named NAME that has not been unlinked, or
+   a null pointer if there is none.  shm_lock must be held. */
+static struct shm_segment *lookup_name(const char *name)
+{
+    for (struct list_elem *e = list_begin(&segments); e != list_end(&segments);
+         e = list_next(e))
+    {
+        struct shm_segment *seg = list_entry(e, struct shm_segment, elem);
+        if (!seg->unlinked && !strcmp(seg->name, name))
+            return seg;
+    }
+    return NULL;
+}
+
+/* Returns the segment with identifier SHMID, or a null pointer
+   if there is none.  shm_lock must be held. */
+static struct shm_segment *lookup_id(int shmid)
+{
+    for (struct list_elem *e = list_begin(&segments); e != list_end(&segments);
+         e = list_next(e))
+    {
+        struct shm_segment *seg = list_entry(e, struct shm_segment, elem);
+        if (seg->id == shmid)
+            return seg;
+    }
+    return NULL;
+}
+
+/* Creates a segment named NAME of PAGE_CNT zeroed pages and adds
+   it to the table.  Returns the new segment, or a null pointer if
+   it would take the segments past SHM_TOTAL_PAGE_MAX pages or
+   memory cannot be allocated.  shm_lock must be held. */
+static struct shm_segment *create(const char *name, size_t page_cnt)
+{
+    struct shm_segment *seg;
+
+    if (page_cnt > SHM_TOTAL_PAGE_MAX - total_page_cnt)
+        return NULL;
+
+    seg = malloc(sizeof *seg);
+    if (seg == NULL)
+        return NULL;
+
+    seg->kpages = calloc(page_cnt, sizeof *seg->kpages);
+    if (seg->kpages == NULL)
+    {
+        free(seg);
+        return NULL;
+    }
+
+    seg->page_cnt = page_cnt;
+    for (size_t i = 0; i < page_cnt; i++)
+    {
+        seg->kpages[i] = palloc_get_page(PAL_ZERO);
+        if (seg->kpages[i] == NULL)
+        {
+            while (i-- > 0)
+                palloc_free_page(seg->kpages[i]);
+            free(seg->kpages);
+            free(seg);
+            return NULL;
+        }
+    }
+
+    total_page_cnt += page_cnt;
+    seg->id = next_id++;
+    strlcpy(seg->name, name, sizeof seg->name);
+    seg->unlinked = false;
+    seg->attach_cnt = 0;
+    list_push_back(&segments, &seg->elem);
+    return seg;
+}
+
+/* Frees SEG once its name is unlinked and it is no longer
+   attached anywhere.  shm_lock must be held. */
+static void release(struct shm_segment *seg)
+{
+    if (!seg->unlinked || seg->attach_cnt > 0)
+        return;
+
+    list_remove(&seg->elem);
+    for (size_t i = 0; i < seg->page_cnt; i++)
+        palloc_free_page(seg->kpages[i]);
+    total_page_cnt -= seg->page_cnt;
+    free(seg->kpages);
+    free(seg);
+}
+
+/* Returns the identifier of the segment named NAME, creating it
+   with SIZE bytes, rounded up to whole pages, if it does not
+   exist.  A SIZE of 0 only looks up an existing segment.  Returns
+   -1 if NAME is empty or too long, if the segment exists but is
+   smaller than SIZE, or if it does not exist and cannot be
+   created. */
+int shm_get(const char *name, size_t size)
+{
+    size_t page_cnt = DIV_ROUND_UP(size, PGSIZE);
+    struct shm_segment *seg;
+    int shmid = -1;
+
+    if (name[0] == '\0' || strlen(name) > SHM_NAME_MAX || page_cnt > SHM_PAGE_MAX)
+        return -1;
+
+    lock_acquire(&shm_lock);
+    seg = lookup_name(name);
+    if (seg == NULL && page_cnt > 0)
+        seg = create(name, page_cnt);
+    if (seg != NULL && seg->page_cnt >= page_cnt)
+        shmid = seg->id;
+    lock_release(&shm_lock);
+
+    return shmid;
+}
+
+/* Maps every page of segment SHMID into the current process's
+   address space starting at ADDR.  The pages are resident and
+   writable for as long as the attachment lasts.  Returns false
+   if there is no such segment, if ADDR is null or not
+   page-aligned, or if the range overlaps any existing page. */
+bool shm_map(int shmid, void *addr)
+{
+    struct process *self = thread_current()->process;
+    struct shm_attachment *a;
+    struct shm_segment *seg;
+    size_t i;
+
+    if (addr == NULL || pg_ofs(addr) != 0)
+        return false;
+
+    a = malloc(sizeof *a);
+    if (a == NULL)
+        return false;
+
+    lock_acquire(&self->mm_lock);
+    lock_acquire(&shm_lock);
+    seg = lookup_id(shmid);
+    if (seg == NULL)
+        goto fail;
+
+    /* The whole range must be unused user memory outside the
+       region reserved for stack growth. */
+    for (i = 0; i < seg->page_cnt; i++)
+    {
+        void *upage = (uint8_t *)addr + i * PGSIZE;
+        if (upage >= page_stack_bottom() || page_for_addr(upage) != NULL)
+            goto fail;
+    }
+
+    for (i = 0; i < seg->page_cnt; i++)
+    {
+        void *upage = (uint8_t *)addr + i * PGSIZE;
+        struct page *p = page_allocate(upage, true);
+        if (p == NULL)
+            goto unmap;
+
+        p->shm_kpage = seg->kpages[i];
+        if (!pagedir_set_page(thread_current()->pagedir, upage, p->shm_kpage, true))
+        {
+            i++;
+            goto unmap;
+        }
+    }
+
+    seg->attach_cnt++;
+    lock_release(&shm_lock);
+
+    a->seg = seg;
+    a->base = addr;
+    list_push_back(&self->shm_attachments, &a->elem);
+    lock_release(&self->mm_lock);
+    return true;
+
+unmap:
+    while (i-- > 0)
+        page_deallocate((uint8_t *)addr + i * PGSIZE);
+fail:
+    lock_release(&shm_lock);
+    lock_release(&self->mm_lock);
+    free(a);
+    return false;
+}
+
+/* Detaches the segment attached at ADDR from the current
+   process.  Returns false if no segment is attached there. */
+bool shm_unmap(void *addr)
+{
+    struct process *self = thread_current()->process;
+    struct list *l = &self->shm_attachments;
+    bool found = false;
+
+    lock_acquire(&self->mm_lock);
+    for (struct list_elem *e = list_begin(l); e != list_end(l); e = list_next(e))
+    {
+        struct shm_attachment *a = list_entry(e, struct shm_attachment, elem);
+        if (a->base == addr)
+        {
+            detach(a);
+            found = true;
+            break;
+        }
+    }
+    lock_release(&self->mm_lock);
+
+    return found;
+}
+
+/* Removes the name NAME, so that shm_get() no longer finds it.
+   The segment itself is freed once it is no longer attached
+   anywhere.  Returns false if there is no segment named NAME. */
+bool shm_remove(const char *name)
+{
+    struct shm_segment *seg;
+
+    lock_acquire(&shm_lock);
+    seg = lookup_name(name);
+    if (seg != NULL)
+    {
+        seg->unlinked = true;
+        release(seg);
+    }
+    lock_release(&shm_lock);
+
+    return seg != NULL;
+}
+
+/* Detaches all of the current process's segments.  No other
+   thread of the process may be left. */
+void shm_exit(void)
+{
+    struct list *l = &thread_current()->process->shm_attachments;
+
+    while (!list_empty(l))
+        detach(list_entry(list_front(l), struct shm_attachment, elem));
+}
+
+/* Unmaps and removes attachment A, releasing its segment if this
+   was the last use of it. */
+static void detach(struct shm_attachment *a)
+{
+    struct shm_segment *seg = a->seg;
+
+    list_remove(&a->elem);
+    for (size_t i = 0; i < seg->page_cnt; i++)
+        page_deallocate(a->base + i * PGSIZE);
+
+    lock_acquire(&shm_lock);
+    seg->attach_cnt--;
+    release(seg);
+    lock_release(&shm_lock);
+
+    free(a);
+}
@@ -0,0 +1,25 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Longest shared memory segment name. */
+#define SHM_NAME_MAX 14
+
+/* Largest shared memory segment, in pages. */
+#define SHM_PAGE_MAX 64
+
+/* Most pages that all shared memory segments together may hold.
+   They come from the kernel pool, which the rest of the kernel
+   needs too. */
+#define SHM_TOTAL_PAGE_MAX 128
+
+void shm_init(void);
+int shm_get(const char *name, size_t size);
+bool shm_map(int shmid, void *addr);
+bool shm_unmap(void *addr);
+bool shm_remove(const char *name);
+void shm_exit(void);
+
+#endif /* vm/shm.h */
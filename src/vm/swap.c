@@ -0,0 +1,76 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* The swap device. */
+static struct block *swap_device;
+
+/* Used swap slots, one bit per page-sized slot. */
+static struct bitmap *swap_bitmap;
+
+/* Protects swap_bitmap. */
+static struct lock swap_lock;
+
+/* Sets up swap.  Without a swap device every swap_out() fails,
+   so only clean pages can be evicted. */
+void swap_init(void)
+{
+    size_t slot_cnt = 0;
+
+    swap_device = block_get_role(BLOCK_SWAP);
+    if (swap_device == NULL)
+        printf("no swap device--swap disabled\n");
+    else
+        slot_cnt = block_size(swap_device) / PAGE_SECTORS;
+
+    swap_bitmap = bitmap_create(slot_cnt);
+    if (swap_bitmap == NULL)
+        PANIC("couldn't create swap bitmap");
+    lock_init(&swap_lock);
+}
+
+/* Writes the page at KPAGE to a free swap slot and returns the
+   slot, or SWAP_SLOT_NONE if swap is full. */
+swap_slot_t swap_out(const void *kpage)
+{
+    lock_acquire(&swap_lock);
+    swap_slot_t slot = bitmap_scan_and_flip(swap_bitmap, 0, 1, false);
+    lock_release(&swap_lock);
+
+    if (slot == BITMAP_ERROR)
+        return SWAP_SLOT_NONE;
+
+    for (size_t i = 0; i < PAGE_SECTORS; i++)
+        block_write(swap_device, slot * PAGE_SECTORS + i,
+                    (const uint8_t *)kpage + i * BLOCK_SECTOR_SIZE);
+    return slot;
+}
+
+/* Reads SLOT into the page at KPAGE and releases SLOT. */
+void swap_in(swap_slot_t slot, void *kpage)
+{
+    ASSERT(slot != SWAP_SLOT_NONE);
+
+    for (size_t i = 0; i < PAGE_SECTORS; i++)
+        block_read(swap_device, slot * PAGE_SECTORS + i,
+                   (uint8_t *)kpage + i * BLOCK_SECTOR_SIZE);
+    swap_free(slot);
+}
+
+/* Releases SLOT without reading it. */
+void swap_free(swap_slot_t slot)
+{
+    ASSERT(slot != SWAP_SLOT_NONE);
+
+    lock_acquire(&swap_lock);
+    ASSERT(bitmap_test(swap_bitmap, slot));
+    bitmap_reset(swap_bitmap, slot);
+    lock_release(&swap_lock);
+}
@@ -0,0 +1,16 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Swap slot index.  A slot holds exactly one page. */
+typedef size_t swap_slot_t;
+#define SWAP_SLOT_NONE ((swap_slot_t)-1) /* No slot. */
+
+void swap_init(void);
+swap_slot_t swap_out(const void *kpage);
+void swap_in(swap_slot_t, void *kpage);
+void swap_free(swap_slot_t);
+
+#endif /* vm/swap.h */
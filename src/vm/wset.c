@@ -0,0 +1,138 @@
+#include "vm/wset.h"
+#include <stdio.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+
+/* Page-fault-frequency control.
+
+   A process's resident set grows by one page on every page-in.
+   When memory is full and a process pages in after a long quiet
+   interval, it has moved on to a smaller working set, so the
+   pages it has not touched since its previous page-in are
+   evicted.
+
+   When memory is full and two processes page in within a few
+   ticks of each other, they are thrashing.  Load control then
+   suspends the faulting process whole for a while, and the clock
+   takes its pages first, so that the others can run. */
+
+/* Page-ins at least this many ticks apart shrink the resident set. */
+#define PFF_SHRINK_TICKS (TIMER_FREQ / 4)
+
+/* Page-ins closer together than this count as thrashing. */
+#define PFF_THRASH_TICKS 2
+
+/* How long load control suspends a thrashing process. */
+#define SUSPEND_TICKS TIMER_FREQ
+
+bool wset_stats;
+
+/* Process that paged in most recently, and when. */
+static struct process *last_faulter;
+static int64_t last_fault_time;
+
+/* Process suspended by load control, or null.  Only one process
+   is suspended at a time, so that the rest keep running. */
+static struct process *suspended;
+
+/* Load control, called on every page fault from user mode, when
+   the process holds no kernel locks.  Suspends the current
+   process if it is thrashing against another one. */
+void wset_admit(void)
+{
+    struct process *self = thread_current()->process;
+    int64_t now = timer_ticks();
+    enum intr_level old_level;
+    bool suspend;
+
+    old_level = intr_disable();
+    suspend = suspended == NULL && frame_free_cnt() == 0
+              && last_faulter != NULL && last_faulter != self
+              && now - last_fault_time < PFF_THRASH_TICKS
+              && now - self->last_fault < PFF_THRASH_TICKS;
+    if (suspend)
+        suspended = self;
+    intr_set_level(old_level);
+
+    if (suspend)
+    {
+        self->suspend_cnt++;
+        timer_sleep(SUSPEND_TICKS);
+        suspended = NULL;
+    }
+}
+
+/* Page-fault-frequency control, called by the current process
+   just before it pages in. */
+void wset_fault(void)
+{
+    struct process *self = thread_current()->process;
+    int64_t now = timer_ticks();
+    enum intr_level old_level;
+
+    self->fault_cnt++;
+    if (now - self->last_fault >= PFF_SHRINK_TICKS && frame_free_cnt() == 0)
+        frame_trim(self->thread);
+
+    old_level = intr_disable();
+    self->last_fault = now;
+    last_faulter = self;
+    last_fault_time = now;
+    intr_set_level(old_level);
+}
+
+/* Prints P's statistics if requested, and forgets P. */
+void wset_exit(struct process *p)
+{
+    enum intr_level old_level;
+
+    if (wset_stats)
+    {
+        int64_t ticks = timer_elapsed(p->start_time);
+        printf("%s: %zu pages peak resident, %u page-ins (%lld/s), "
+               "%u evictions, %u suspensions\n",
+               p->thread->name, p->resident_peak, p->fault_cnt,
+               p->fault_cnt * TIMER_FREQ / (ticks > 0 ? ticks : 1),
+               p->evict_cnt, p->suspend_cnt);
+    }
+
+    old_level = intr_disable();
+    if (last_faulter == p)
+        last_faulter = NULL;
+    intr_set_level(old_level);
+}
+
+/* Counts a newly resident page P against its process. */
+void wset_charge(struct page *p)
+{
+    struct process *proc = p->thread->process;
+    enum intr_level old_level = intr_disable();
+
+    if (++proc->resident_cnt > proc->resident_peak)
+        proc->resident_peak = proc->resident_cnt;
+    intr_set_level(old_level);
+}
+
+/* Stops counting page P against its process.  EVICTED is true if
+   page replacement took P's frame. */
+void wset_uncharge(struct page *p, bool evicted)
+{
+    struct process *proc = p->thread->process;
+    enum intr_level old_level = intr_disable();
+
+    proc->resident_cnt--;
+    if (evicted)
+        proc->evict_cnt++;
+    intr_set_level(old_level);
+}
+
+/* Returns true if P belongs to a process suspended by load
+   control. */
+bool wset_suspended(struct page *p)
+{
+    return p->thread->process == suspended;
+}
@@ -0,0 +1,21 @@
+#ifndef VM_WSET_H
+#define VM_WSET_H
+
+#include <stdbool.h>
+
+struct page;
+struct process;
+
+/* Print each process's working-set statistics when it exits?
+   Controlled by kernel command-line option "-vmstats". */
+extern bool wset_stats;
+
+void wset_admit(void);
+void wset_fault(void);
+void wset_exit(struct process *);
+
+void wset_charge(struct page *);
+void wset_uncharge(struct page *, bool evicted);
+bool wset_suspended(struct page *);
+
+#endif /* vm/wset.h */